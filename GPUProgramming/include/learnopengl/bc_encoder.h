@@ -0,0 +1,344 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include <learnopengl/compressed_texture.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// CPU block compressor for the offline texture cooker. Every 4x4 block gets its endpoints from the
+// principal axis of its texels (the direction they vary most along), then each texel picks the
+// nearest palette entry. BC7 only uses mode 6 (one subset, RGBA, 4 bit indices), which already
+// beats BC1/BC3 clearly on smooth gradients; it is not meant to compete with a full mode search.
+class BlockEncoder {
+public:
+    // compresses a tightly packed RGBA8 image; edge blocks of non multiple of 4 sizes repeat the last row/column
+    static std::vector<unsigned char> Encode(const unsigned char *rgba, int width, int height, BlockFormat format)
+    {
+        int blocksX = (width + 3) / 4;
+        int blocksY = (height + 3) / 4;
+        size_t blockBytes = CompressedTexture::BlockBytes(format);
+        std::vector<unsigned char> blocks(blocksX * blocksY * blockBytes);
+
+        unsigned char texels[64];
+        for (int by = 0; by < blocksY; by++)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                for (int y = 0; y < 4; y++)
+                {
+                    int sy = std::min(by * 4 + y, height - 1);
+                    for (int x = 0; x < 4; x++)
+                    {
+                        int sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(&texels[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+                    }
+                }
+                unsigned char *block = &blocks[(by * blocksX + bx) * blockBytes];
+                if (format == BLOCK_FORMAT_BC1)
+                    EncodeBC1(texels, block);
+                else if (format == BLOCK_FORMAT_BC3)
+                    EncodeBC3(texels, block);
+                else if (format == BLOCK_FORMAT_BC5)
+                    EncodeBC5(texels, block);
+                else
+                    EncodeBC7(texels, block);
+            }
+        }
+        return blocks;
+    }
+
+    // 16 RGBA texels in, 8 bytes out. Alpha is ignored.
+    static void EncodeBC1(const unsigned char *texels, unsigned char *block)
+    {
+        float values[16 * 3];
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                values[i * 3 + c] = texels[i * 4 + c];
+        float low[3], high[3];
+        fitLine(values, 3, low, high, true);
+
+        unsigned int color0 = pack565(high);
+        unsigned int color1 = pack565(low);
+        if (color0 < color1)
+            std::swap(color0, color1);
+        writeLE16(block, color0);
+        writeLE16(block + 2, color1);
+        unsigned int indices = 0;
+        // equal endpoints would select the 3 colour + transparent mode, so every texel just uses color0
+        if (color0 != color1)
+        {
+            float palette[4][3];
+            unpack565(color0, palette[0]);
+            unpack565(color1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+            for (int i = 0; i < 16; i++)
+                indices |= nearest(&values[i * 3], &palette[0][0], 4, 3) << (2 * i);
+        }
+        writeLE16(block + 4, indices & 0xFFFF);
+        writeLE16(block + 6, indices >> 16);
+    }
+
+    // BC4 alpha block followed by a BC1 colour block
+    static void EncodeBC3(const unsigned char *texels, unsigned char *block)
+    {
+        unsigned char alpha[16];
+        for (int i = 0; i < 16; i++)
+            alpha[i] = texels[i * 4 + 3];
+        encodeBC4(alpha, block);
+        EncodeBC1(texels, block + 8);
+    }
+
+    // red and green as two BC4 blocks
+    static void EncodeBC5(const unsigned char *texels, unsigned char *block)
+    {
+        unsigned char channel[16];
+        for (int c = 0; c < 2; c++)
+        {
+            for (int i = 0; i < 16; i++)
+                channel[i] = texels[i * 4 + c];
+            encodeBC4(channel, block + c * 8);
+        }
+    }
+
+    // BC7 mode 6: 7 bit RGBA endpoints with a shared low bit (p-bit) each, 4 bit indices
+    static void EncodeBC7(const unsigned char *texels, unsigned char *block)
+    {
+        float values[16 * 4];
+        for (int i = 0; i < 64; i++)
+            values[i] = texels[i];
+        float low[4], high[4];
+        fitLine(values, 4, low, high, false);
+
+        unsigned int endpoints[2][4];
+        unsigned int pbits[2] = { 0, 0 };
+        quantizeBC7Endpoint(low, endpoints[0], pbits[0]);
+        quantizeBC7Endpoint(high, endpoints[1], pbits[1]);
+
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        float palette[16][4];
+        for (int c = 0; c < 4; c++)
+        {
+            int e0 = (int)((endpoints[0][c] << 1) | pbits[0]);
+            int e1 = (int)((endpoints[1][c] << 1) | pbits[1]);
+            for (int i = 0; i < 16; i++)
+                palette[i][c] = (float)(((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6);
+        }
+        unsigned int indices[16];
+        for (int i = 0; i < 16; i++)
+            indices[i] = nearest(&values[i * 4], &palette[0][0], 16, 4);
+
+        // the first texel's index is stored with its top bit implied 0: flip the line if it's set
+        if (indices[0] & 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(endpoints[0][c], endpoints[1][c]);
+            std::swap(pbits[0], pbits[1]);
+            for (int i = 0; i < 16; i++)
+                indices[i] = 15 - indices[i];
+        }
+
+        std::memset(block, 0, 16);
+        unsigned int bit = 0;
+        writeBits(block, bit, 1 << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writeBits(block, bit, endpoints[0][c], 7);
+            writeBits(block, bit, endpoints[1][c], 7);
+        }
+        writeBits(block, bit, pbits[0], 1);
+        writeBits(block, bit, pbits[1], 1);
+        for (int i = 0; i < 16; i++)
+            writeBits(block, bit, indices[i], i == 0 ? 3 : 4);
+    }
+
+private:
+    // endpoints of the segment through the texels along their principal axis. 'inset' pulls the
+    // ends in by 1/16 of the range, which suits the 4 entry BC1 palette better than the extremes.
+    static void fitLine(const float *values, int channels, float *low, float *high, bool inset)
+    {
+        float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < channels; c++)
+                mean[c] += values[i * channels + c] / 16.0f;
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; i++)
+            for (int a = 0; a < channels; a++)
+                for (int b = 0; b < channels; b++)
+                    covariance[a][b] += (values[i * channels + a] - mean[a]) * (values[i * channels + b] - mean[b]);
+
+        // power iteration for the dominant eigenvector, started on the channel that varies most. A
+        // fixed start like the grey axis can be orthogonal to how the colours vary (a red/green
+        // checker) and would collapse the block to its mean.
+        int widest = 0;
+        for (int c = 1; c < channels; c++)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        axis[widest] = 1.0f;
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float length = 0.0f;
+            for (int a = 0; a < channels; a++)
+            {
+                for (int b = 0; b < channels; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length = std::max(length, std::fabs(next[a]));
+            }
+            // flat block (any axis works) or an iterate that vanished: keep the widest channel
+            if (length == 0.0f)
+            {
+                for (int a = 0; a < channels; a++)
+                    axis[a] = a == widest ? 1.0f : 0.0f;
+                break;
+            }
+            for (int a = 0; a < channels; a++)
+                axis[a] = next[a] / length;
+        }
+        float lengthSquared = 0.0f;
+        for (int c = 0; c < channels; c++)
+            lengthSquared += axis[c] * axis[c];
+
+        float minT = 0.0f, maxT = 0.0f;
+        if (lengthSquared > 0.0f)
+        {
+            minT = 1e30f;
+            maxT = -1e30f;
+            for (int i = 0; i < 16; i++)
+            {
+                float t = 0.0f;
+                for (int c = 0; c < channels; c++)
+                    t += (values[i * channels + c] - mean[c]) * axis[c];
+                t /= lengthSquared;
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            if (inset)
+            {
+                float shrink = (maxT - minT) / 16.0f;
+                minT += shrink;
+                maxT -= shrink;
+            }
+        }
+        for (int c = 0; c < channels; c++)
+        {
+            low[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+            high[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+        }
+    }
+
+    // index of the palette entry closest to 'value'
+    static unsigned int nearest(const float *value, const float *palette, int count, int channels)
+    {
+        unsigned int best = 0;
+        float bestError = 1e30f;
+        for (int i = 0; i < count; i++)
+        {
+            float error = 0.0f;
+            for (int c = 0; c < channels; c++)
+            {
+                float d = value[c] - palette[i * channels + c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = (unsigned int)i;
+            }
+        }
+        return best;
+    }
+
+    // 8 interpolated values between the extremes, 3 bit indices
+    static void encodeBC4(const unsigned char *values, unsigned char *block)
+    {
+        unsigned char low = 255, high = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            low = std::min(low, values[i]);
+            high = std::max(high, values[i]);
+        }
+        block[0] = high;
+        block[1] = low;
+        unsigned long long indices = 0;
+        if (high != low)
+        {
+            // high > low selects the 8 value mode: index 0 = high, 1 = low, 2..7 in between
+            float palette[8];
+            palette[0] = high;
+            palette[1] = low;
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * high + (i - 1) * low) / 7.0f;
+            for (int i = 0; i < 16; i++)
+            {
+                float value = values[i];
+                indices |= (unsigned long long)nearest(&value, palette, 8, 1) << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            block[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+
+    // picks the p-bit that reproduces the endpoint best; the decoded value is (q << 1) | p
+    static void quantizeBC7Endpoint(const float *value, unsigned int *quantized, unsigned int &pbit)
+    {
+        float bestError = 1e30f;
+        for (unsigned int p = 0; p < 2; p++)
+        {
+            unsigned int q[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                int level = (int)std::floor((value[c] - p) / 2.0f + 0.5f);
+                q[c] = (unsigned int)std::min(std::max(level, 0), 127);
+                float d = (float)((q[c] << 1) | p) - value[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbit = p;
+                std::memcpy(quantized, q, sizeof(q));
+            }
+        }
+    }
+
+    static unsigned int pack565(const float *color)
+    {
+        unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+        unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+        unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+        return (r << 11) | (g << 5) | b;
+    }
+
+    static void unpack565(unsigned int packed, float *color)
+    {
+        unsigned int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (float)((r << 3) | (r >> 2));
+        color[1] = (float)((g << 2) | (g >> 4));
+        color[2] = (float)((b << 3) | (b >> 2));
+    }
+
+    static void writeLE16(unsigned char *out, unsigned int value)
+    {
+        out[0] = (unsigned char)(value & 0xFF);
+        out[1] = (unsigned char)((value >> 8) & 0xFF);
+    }
+
+    // appends 'count' bits of 'value', least significant first
+    static void writeBits(unsigned char *block, unsigned int &bit, unsigned int value, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; i++, bit++)
+            if (value & (1u << i))
+                block[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+    }
+};
+#endif
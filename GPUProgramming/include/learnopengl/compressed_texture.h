@@ -0,0 +1,294 @@
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/mip_generator.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// block compressed formats the cooker writes and the runtime uploads as is
+enum BlockFormat {
+    BLOCK_FORMAT_BC1, // RGB (opaque), 8 bytes per 4x4 block
+    BLOCK_FORMAT_BC3, // RGBA, 16 bytes per block
+    BLOCK_FORMAT_BC5, // two channels (normal map XY), 16 bytes per block
+    BLOCK_FORMAT_BC7  // high quality RGBA, 16 bytes per block
+};
+
+// a block compressed image with its whole mip chain, level 0 first
+struct CompressedImage {
+    BlockFormat format;
+    // colour data is sRGB encoded
+    bool srgb;
+    int width;
+    int height;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+// Reads and writes block compressed images in DDS files (always with the DX10 extension header,
+// legacy DXT1/DXT5/ATI2 files are read too) and uploads them with glCompressedTexImage2D: no
+// decode, no glGenerateMipmap, and 4-8x less memory than RGB(A)8. The files are produced offline
+// by tools/texture_cooker.cpp.
+class CompressedTexture {
+public:
+    static size_t BlockBytes(BlockFormat format)
+    {
+        return format == BLOCK_FORMAT_BC1 ? 8 : 16;
+    }
+
+    // bytes of one mip level; partial blocks at the edges count as whole blocks
+    static size_t LevelSize(BlockFormat format, int width, int height)
+    {
+        size_t blocksX = (size_t)(std::max(width, 1) + 3) / 4;
+        size_t blocksY = (size_t)(std::max(height, 1) + 3) / 4;
+        return blocksX * blocksY * BlockBytes(format);
+    }
+
+    // the cooked file that belongs to a source image: same path, .dds extension
+    static std::string CookedPath(const std::string &source)
+    {
+        size_t dot = source.find_last_of('.');
+        size_t slash = source.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return source + ".dds";
+        return source.substr(0, dot) + ".dds";
+    }
+
+    // true if the source image was cooked
+    static bool HasCooked(const std::string &source)
+    {
+        std::ifstream file(CookedPath(source).c_str(), std::ios::binary);
+        return file.is_open();
+    }
+
+    // true if the context can sample the format (S3TC and BPTC are extensions on a 3.3 context)
+    static bool Supported(BlockFormat format)
+    {
+        if (format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC3)
+            return glExtensions().textureCompressionS3TC;
+        if (format == BLOCK_FORMAT_BC7)
+            return glExtensions().textureCompressionBPTC;
+        return true;
+    }
+
+    static GLenum InternalFormat(BlockFormat format, bool srgb)
+    {
+        switch (format)
+        {
+        case BLOCK_FORMAT_BC1: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case BLOCK_FORMAT_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BLOCK_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+        default:               return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    // reads a DDS file; returns false (without output) if the file is missing and prints why otherwise
+    static bool Load(const std::string &path, CompressedImage &image)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file)
+            return false;
+
+        unsigned int magic = 0;
+        DDSHeader header;
+        DDSHeaderDX10 dx10;
+        bool valid = file.read((char *)&magic, sizeof(magic)) && magic == DDS_MAGIC
+            && file.read((char *)&header, sizeof(header)) && header.size == sizeof(DDSHeader)
+            && (header.pixelFormat.flags & DDPF_FOURCC) != 0;
+        if (valid && header.pixelFormat.fourCC == fourCC("DX10"))
+            valid = file.read((char *)&dx10, sizeof(dx10)) && dx10.resourceDimension == DDS_DIMENSION_TEXTURE2D && dx10.arraySize <= 1
+                && formatFromDXGI(dx10.dxgiFormat, image.format, image.srgb);
+        else if (valid)
+            valid = formatFromFourCC(header.pixelFormat.fourCC, image.format, image.srgb);
+
+        // reject sizes no GL texture can have before anything is allocated for them
+        valid = valid && header.width > 0 && header.height > 0 && header.width <= MAX_DIMENSION && header.height <= MAX_DIMENSION;
+        if (valid)
+        {
+            image.width = (int)header.width;
+            image.height = (int)header.height;
+            unsigned int levelCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+            levelCount = std::min(levelCount, MipGenerator::LevelCount(image.width, image.height));
+            image.levels.resize(levelCount);
+            for (unsigned int level = 0; level < levelCount && valid; level++)
+            {
+                image.levels[level].resize(LevelSize(image.format, std::max(image.width >> level, 1), std::max(image.height >> level, 1)));
+                valid = (bool)file.read((char *)image.levels[level].data(), image.levels[level].size());
+            }
+        }
+        if (!valid)
+        {
+            std::cout << "ERROR::COMPRESSED_TEXTURE::UNSUPPORTED_FILE: " << path << std::endl;
+            image.levels.clear();
+        }
+        return valid;
+    }
+
+    static bool Save(const std::string &path, const CompressedImage &image)
+    {
+        DDSHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.size = sizeof(DDSHeader);
+        header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+        header.height = (unsigned int)image.height;
+        header.width = (unsigned int)image.width;
+        header.pitchOrLinearSize = (unsigned int)LevelSize(image.format, image.width, image.height);
+        header.mipMapCount = (unsigned int)image.levels.size();
+        header.pixelFormat.size = sizeof(DDSPixelFormat);
+        header.pixelFormat.flags = DDPF_FOURCC;
+        header.pixelFormat.fourCC = fourCC("DX10");
+        header.caps = DDSCAPS_TEXTURE | (image.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+        DDSHeaderDX10 dx10;
+        dx10.dxgiFormat = dxgiFormat(image.format, image.srgb);
+        dx10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+        dx10.miscFlag = 0;
+        dx10.arraySize = 1;
+        dx10.miscFlags2 = 0;
+
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::COMPRESSED_TEXTURE::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        unsigned int magic = DDS_MAGIC;
+        file.write((const char *)&magic, sizeof(magic));
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)&dx10, sizeof(dx10));
+        for (unsigned int level = 0; level < image.levels.size(); level++)
+            file.write((const char *)image.levels[level].data(), image.levels[level].size());
+        return true;
+    }
+
+    // creates a GL_TEXTURE_2D holding the blocks of every level as they are
+    static unsigned int Upload(const CompressedImage &image)
+    {
+        GLenum internalFormat = InternalFormat(image.format, image.srgb);
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        for (unsigned int level = 0; level < image.levels.size(); level++)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, std::max(image.width >> level, 1), std::max(image.height >> level, 1), 0,
+                (GLsizei)image.levels[level].size(), image.levels[level].data());
+        // a chain that stops before 1x1 is still complete
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
+private:
+    static const unsigned int DDS_MAGIC = 0x20534444; // "DDS "
+    // largest width/height accepted from a file (GL_MAX_TEXTURE_SIZE of current desktop GPUs)
+    static const unsigned int MAX_DIMENSION = 16384;
+    static const unsigned int DDSD_CAPS = 0x1;
+    static const unsigned int DDSD_HEIGHT = 0x2;
+    static const unsigned int DDSD_WIDTH = 0x4;
+    static const unsigned int DDSD_PIXELFORMAT = 0x1000;
+    static const unsigned int DDSD_MIPMAPCOUNT = 0x20000;
+    static const unsigned int DDSD_LINEARSIZE = 0x80000;
+    static const unsigned int DDPF_FOURCC = 0x4;
+    static const unsigned int DDSCAPS_COMPLEX = 0x8;
+    static const unsigned int DDSCAPS_TEXTURE = 0x1000;
+    static const unsigned int DDSCAPS_MIPMAP = 0x400000;
+    static const unsigned int DDS_DIMENSION_TEXTURE2D = 3;
+
+    // DXGI_FORMAT values
+    static const unsigned int DXGI_BC1_UNORM = 71;
+    static const unsigned int DXGI_BC1_UNORM_SRGB = 72;
+    static const unsigned int DXGI_BC3_UNORM = 77;
+    static const unsigned int DXGI_BC3_UNORM_SRGB = 78;
+    static const unsigned int DXGI_BC5_UNORM = 83;
+    static const unsigned int DXGI_BC7_UNORM = 98;
+    static const unsigned int DXGI_BC7_UNORM_SRGB = 99;
+
+    struct DDSPixelFormat {
+        unsigned int size;
+        unsigned int flags;
+        unsigned int fourCC;
+        unsigned int rgbBitCount;
+        unsigned int bitMasks[4];
+    };
+
+    struct DDSHeader {
+        unsigned int size;
+        unsigned int flags;
+        unsigned int height;
+        unsigned int width;
+        unsigned int pitchOrLinearSize;
+        unsigned int depth;
+        unsigned int mipMapCount;
+        unsigned int reserved1[11];
+        DDSPixelFormat pixelFormat;
+        unsigned int caps;
+        unsigned int caps2;
+        unsigned int caps3;
+        unsigned int caps4;
+        unsigned int reserved2;
+    };
+
+    struct DDSHeaderDX10 {
+        unsigned int dxgiFormat;
+        unsigned int resourceDimension;
+        unsigned int miscFlag;
+        unsigned int arraySize;
+        unsigned int miscFlags2;
+    };
+
+    static unsigned int fourCC(const char *code)
+    {
+        return (unsigned int)code[0] | ((unsigned int)code[1] << 8) | ((unsigned int)code[2] << 16) | ((unsigned int)code[3] << 24);
+    }
+
+    static unsigned int dxgiFormat(BlockFormat format, bool srgb)
+    {
+        switch (format)
+        {
+        case BLOCK_FORMAT_BC1: return srgb ? DXGI_BC1_UNORM_SRGB : DXGI_BC1_UNORM;
+        case BLOCK_FORMAT_BC3: return srgb ? DXGI_BC3_UNORM_SRGB : DXGI_BC3_UNORM;
+        case BLOCK_FORMAT_BC5: return DXGI_BC5_UNORM;
+        default:               return srgb ? DXGI_BC7_UNORM_SRGB : DXGI_BC7_UNORM;
+        }
+    }
+
+    static bool formatFromDXGI(unsigned int dxgi, BlockFormat &format, bool &srgb)
+    {
+        srgb = dxgi == DXGI_BC1_UNORM_SRGB || dxgi == DXGI_BC3_UNORM_SRGB || dxgi == DXGI_BC7_UNORM_SRGB;
+        if (dxgi == DXGI_BC1_UNORM || dxgi == DXGI_BC1_UNORM_SRGB)
+            format = BLOCK_FORMAT_BC1;
+        else if (dxgi == DXGI_BC3_UNORM || dxgi == DXGI_BC3_UNORM_SRGB)
+            format = BLOCK_FORMAT_BC3;
+        else if (dxgi == DXGI_BC5_UNORM)
+            format = BLOCK_FORMAT_BC5;
+        else if (dxgi == DXGI_BC7_UNORM || dxgi == DXGI_BC7_UNORM_SRGB)
+            format = BLOCK_FORMAT_BC7;
+        else
+            return false;
+        return true;
+    }
+
+    static bool formatFromFourCC(unsigned int code, BlockFormat &format, bool &srgb)
+    {
+        srgb = false;
+        if (code == fourCC("DXT1"))
+            format = BLOCK_FORMAT_BC1;
+        else if (code == fourCC("DXT5"))
+            format = BLOCK_FORMAT_BC3;
+        else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+            format = BLOCK_FORMAT_BC5;
+        else
+            return false;
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,156 @@
+#ifndef COMPUTE_SHADER_H
+#define COMPUTE_SHADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// A program with a single compute stage (GL 4.3 / ARB_compute_shader, check glExtensions().computeShader
+// before creating one). Sources go through the ShaderPreprocessor and linked binaries through the
+// ProgramCache like those of Shader; uniforms are looked up by UniformHandle from a table reflected
+// at link time, and the FrameData block is bound like in every other program.
+class ComputeShader
+{
+public:
+    unsigned int ID;
+
+    ComputeShader(const char *computePath, const std::vector<std::string> &defines = std::vector<std::string>())
+    {
+        std::string computeCode = ShaderPreprocessor::Load(computePath, defines);
+        ID = glCreateProgram();
+        unsigned long long cacheKey = 0;
+        if (ProgramCache::Enabled())
+        {
+            std::string defineList;
+            for (unsigned int i = 0; i < defines.size(); i++)
+                defineList += defines[i] + ";";
+            cacheKey = ProgramCache::Key({ computeCode, defineList });
+            if (ProgramCache::Load(ID, cacheKey))
+            {
+                finishProgram();
+                return;
+            }
+        }
+        const char *cShaderCode = computeCode.c_str();
+        unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        checkCompileErrors(compute, "COMPUTE");
+        glAttachShader(ID, compute);
+        ProgramCache::PrepareForStore(ID);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(compute);
+        ProgramCache::Store(ID, cacheKey);
+        finishProgram();
+    }
+
+    void use()
+    {
+        glUseProgram(ID);
+    }
+
+    // runs the bound program over groups x, y, z work groups
+    void Dispatch(unsigned int x, unsigned int y = 1, unsigned int z = 1)
+    {
+        glExtensions().DispatchCompute(x, y, z);
+    }
+
+    GLint location(UniformHandle name) const
+    {
+        std::vector<std::pair<unsigned int, GLint>>::const_iterator it = std::lower_bound(uniformLocations.begin(), uniformLocations.end(), std::make_pair(name.hash, (GLint)-1));
+        return (it != uniformLocations.end() && it->first == name.hash) ? it->second : -1;
+    }
+
+    // utility uniform functions
+    void setInt(UniformHandle name, int value) const
+    {
+        glUniform1i(location(name), value);
+    }
+    void setUint(UniformHandle name, unsigned int value) const
+    {
+        glUniform1ui(location(name), value);
+    }
+    void setFloat(UniformHandle name, float value) const
+    {
+        glUniform1f(location(name), value);
+    }
+    void setVec2(UniformHandle name, const glm::vec2 &value) const
+    {
+        glUniform2fv(location(name), 1, &value[0]);
+    }
+    void setIvec2(UniformHandle name, const glm::ivec2 &value) const
+    {
+        glUniform2iv(location(name), 1, &value[0]);
+    }
+    void setMat4(UniformHandle name, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    void Release()
+    {
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+
+private:
+    // uniform name hash -> location, sorted by hash
+    std::vector<std::pair<unsigned int, GLint>> uniformLocations;
+
+    void finishProgram()
+    {
+        GLuint frameBlock = glGetUniformBlockIndex(ID, FRAME_UNIFORMS_BLOCK);
+        if (frameBlock != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, frameBlock, FRAME_UNIFORMS_BINDING);
+
+        // compute programs are small, plain names are enough (no array elements)
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+            GLint loc = glGetUniformLocation(ID, name);
+            if (loc >= 0)
+                uniformLocations.push_back(std::make_pair(HashUniformName(name), loc));
+        }
+        std::sort(uniformLocations.begin(), uniformLocations.end());
+    }
+
+    void checkCompileErrors(GLuint object, const std::string &type)
+    {
+        GLint success;
+        GLchar infoLog[1024];
+        if (type != "PROGRAM")
+        {
+            glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(object, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        else
+        {
+            glGetProgramiv(object, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                glGetProgramInfoLog(object, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+    }
+};
+#endif
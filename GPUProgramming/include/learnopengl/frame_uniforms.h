@@ -0,0 +1,76 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Every Shader binds a uniform block with this name to this binding point after linking, so a
+// program only has to declare the block (std140, same member order as FrameData) to see it:
+//
+//     layout (std140) uniform FrameData
+//     {
+//         mat4 view;
+//         mat4 projection;
+//         mat4 viewProjection;
+//         vec4 cameraPosition; // xyz = world position
+//         vec4 time;           // x = seconds since start, y = frame delta
+//     };
+const char * const FRAME_UNIFORMS_BLOCK = "FrameData";
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+
+// CPU mirror of the block; mat4/vec4 members only, so the C++ layout already matches std140
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPosition;
+    glm::vec4 time;
+};
+
+// Uniform buffer holding the per-frame camera and timing state. It is written once per frame and
+// shared by all programs, instead of every program uploading view/projection on its own.
+class FrameUniforms {
+public:
+    unsigned int UBO;
+
+    // constructor allocates the buffer and attaches it to FRAME_UNIFORMS_BINDING
+    FrameUniforms()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UBO);
+    }
+
+    // uploads this frame's state in one call
+    void Update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition, float time, float deltaTime)
+    {
+        data.view = view;
+        data.projection = projection;
+        data.viewProjection = projection * view;
+        data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+        data.time = glm::vec4(time, deltaTime, 0.0f, 0.0f);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // last uploaded state, e.g. for CPU side culling
+    const FrameData &Data() const
+    {
+        return data;
+    }
+
+    // frees the buffer
+    void Release()
+    {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+
+private:
+    FrameData data;
+};
+#endif
@@ -0,0 +1,394 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/offset_allocator.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// vertex and index data already in the GPU layout of a VertexFormat (Vertex or PackedVertex plus an
+// optional SkinVertex stream, see mesh.h), e.g. mapped straight from a mesh cache file
+struct MeshBuffers {
+    const void *vertices;
+    unsigned int vertexCount;
+    // compressed skinned meshes only, NULL otherwise
+    const void *skin;
+    const unsigned int *indices;
+    unsigned int indexCount;
+};
+
+// a vertex layout of the pool. 'setup' specifies the attributes on the bound VAO given the arena's
+// vertex buffer and, for layouts with a bone stream (skinStride > 0), its bone buffer.
+struct GeometryLayout {
+    unsigned int id;
+    GLsizei stride;
+    GLsizei skinStride;
+    void (*setup)(GLuint vertexBuffer, GLuint skinBuffer);
+};
+
+// where a mesh lives in the pool; offsets change when the pool grows or is defragmented, so meshes
+// keep the handle and look the range up when they draw
+struct GeometryRange {
+    unsigned int arena;
+    OffsetAllocator::Allocation vertices;
+    OffsetAllocator::Allocation indices; // in 2 byte units
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    GLenum indexType;
+    bool live;
+};
+
+// one vertex layout: a vertex array over one large vertex buffer (plus the bone stream of skinned
+// compressed meshes at the same vertex offsets) and one large index buffer
+struct GeometryArena {
+    GeometryLayout layout;
+    unsigned int VAO;
+    unsigned int vertexBuffer;
+    unsigned int skinBuffer;
+    unsigned int indexBuffer;
+    OffsetAllocator vertices;
+    OffsetAllocator indices;
+};
+
+// Shared storage for all mesh geometry. Instead of a VAO, VBO and EBO per mesh there is one arena
+// per vertex layout, and a mesh is a range of it drawn with glDrawElementsBaseVertex, so meshes of
+// one layout draw back to back without rebinding anything (and can later be merged into multi-draws).
+// Ranges are sub-allocated with an OffsetAllocator. Full buffers grow by copying on the GPU; when an
+// allocation fails although there is enough free space in total the arena is defragmented first.
+// Indices are stored as 16 bit whenever a mesh's vertices allow it, 32 bit ones start 4 byte aligned.
+// Uploads go through GL_COPY_WRITE_BUFFER, so they never disturb the element buffer of a bound VAO.
+class GeometryPool {
+public:
+    typedef unsigned int Handle;
+    static const Handle INVALID_HANDLE = 0xFFFFFFFFu;
+
+    // sizes of a new arena, in vertices and indices
+    static const unsigned int INITIAL_VERTICES = 64 * 1024;
+    static const unsigned int INITIAL_INDICES = 256 * 1024;
+
+    static GeometryPool &Get()
+    {
+        static GeometryPool pool;
+        return pool;
+    }
+
+    // copies a mesh into the arena of its layout; 'buffers.skin' is only read if the layout has a bone stream
+    Handle Add(const GeometryLayout &layout, const MeshBuffers &buffers)
+    {
+        unsigned int arenaIndex = arenaFor(layout);
+        GLsizei stride = layout.stride;
+        GLsizei skinStride = layout.skinStride;
+        GeometryRange added;
+        added.arena = arenaIndex;
+        added.vertexCount = buffers.vertexCount;
+        added.indexCount = buffers.indexCount;
+        added.indexType = buffers.vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        added.live = true;
+        added.vertices.offset = added.indices.offset = OffsetAllocator::NO_SPACE;
+        Handle handle;
+        if (!freeHandles.empty())
+        {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            ranges[handle] = added;
+        }
+        else
+        {
+            handle = static_cast<Handle>(ranges.size());
+            ranges.push_back(added);
+        }
+
+        // the range is registered first, so a defragmentation while allocating its indices keeps its vertices
+        ranges[handle].vertices = allocate(arenaIndex, false, buffers.vertexCount);
+        ranges[handle].indices = allocate(arenaIndex, true, indexUnits(ranges[handle]));
+        const GeometryRange &range = ranges[handle];
+        GeometryArena &arena = arenas[arenaIndex];
+        if (range.vertices.offset == OffsetAllocator::NO_SPACE || range.indices.offset == OffsetAllocator::NO_SPACE)
+        {
+            std::cout << "ERROR::GEOMETRY_POOL::OUT_OF_SPACE: " << buffers.vertexCount << " vertices, " << buffers.indexCount << " indices" << std::endl;
+            Remove(handle);
+            return INVALID_HANDLE;
+        }
+
+        upload(arena.vertexBuffer, (GLintptr)range.vertices.offset * stride, (GLsizeiptr)buffers.vertexCount * stride, buffers.vertices);
+        if (skinStride > 0)
+            upload(arena.skinBuffer, (GLintptr)range.vertices.offset * skinStride, (GLsizeiptr)buffers.vertexCount * skinStride, buffers.skin);
+        if (range.indexType == GL_UNSIGNED_SHORT)
+        {
+            vector<unsigned short> narrow(buffers.indices, buffers.indices + buffers.indexCount);
+            upload(arena.indexBuffer, indexOffset(range), (GLsizeiptr)narrow.size() * sizeof(unsigned short), narrow.data());
+        }
+        else
+            upload(arena.indexBuffer, indexOffset(range), (GLsizeiptr)buffers.indexCount * sizeof(unsigned int), buffers.indices);
+        return handle;
+    }
+
+    // frees the range; the handle may be handed out again
+    void Remove(Handle handle)
+    {
+        if (handle >= ranges.size() || !ranges[handle].live)
+            return;
+        GeometryRange &range = ranges[handle];
+        arenas[range.arena].vertices.Free(range.vertices);
+        arenas[range.arena].indices.Free(range.indices);
+        range.live = false;
+        freeHandles.push_back(handle);
+    }
+
+    const GeometryRange &Range(Handle handle) const
+    {
+        return ranges[handle];
+    }
+
+    unsigned int VertexArray(Handle handle) const
+    {
+        return arenas[ranges[handle].arena].VAO;
+    }
+
+    // byte offset of the range's first index in the arena's index buffer
+    GLintptr IndexOffset(Handle handle) const
+    {
+        return indexOffset(ranges[handle]);
+    }
+
+    // changes whenever ranges move (growth, defragmentation), so cached offsets e.g. in indirect
+    // draw commands know when to rebuild
+    unsigned int Generation() const
+    {
+        return generation;
+    }
+
+    // binds the arena's VAO unless it's bound already
+    void Bind(Handle handle)
+    {
+        unsigned int vao = arenas[ranges[handle].arena].VAO;
+        if (vao != boundVertexArray)
+        {
+            glBindVertexArray(vao);
+            boundVertexArray = vao;
+        }
+    }
+
+    // draws the whole range; leaves the arena's VAO bound for the next mesh, see Unbind
+    void Draw(Handle handle)
+    {
+        if (handle >= ranges.size() || !ranges[handle].live)
+            return;
+        Bind(handle);
+        const GeometryRange &range = ranges[handle];
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, range.indexType, (void*)indexOffset(range), (GLint)range.vertices.offset);
+    }
+
+    // draws 'instanceCount' copies of the range; the bound VAO needs its instance attributes set up
+    void DrawInstanced(Handle handle, unsigned int instanceCount)
+    {
+        if (handle >= ranges.size() || !ranges[handle].live || instanceCount == 0)
+            return;
+        Bind(handle);
+        const GeometryRange &range = ranges[handle];
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, range.indexType, (void*)indexOffset(range), (GLsizei)instanceCount, (GLint)range.vertices.offset);
+    }
+
+    // binds no VAO. Call this after a run of Draws, before code that binds VAOs itself.
+    void Unbind()
+    {
+        glBindVertexArray(0);
+        boundVertexArray = 0;
+    }
+
+    // packs every arena's ranges to the front of its buffers, which leaves all free space in one block
+    void Defragment()
+    {
+        for (unsigned int i = 0; i < arenas.size(); i++)
+            defragment(i, arenas[i].vertices.Size(), arenas[i].indices.Size());
+    }
+
+    // deletes every arena; all handles become invalid
+    void Release()
+    {
+        for (unsigned int i = 0; i < arenas.size(); i++)
+        {
+            glDeleteVertexArrays(1, &arenas[i].VAO);
+            glDeleteBuffers(1, &arenas[i].vertexBuffer);
+            glDeleteBuffers(1, &arenas[i].indexBuffer);
+            if (arenas[i].skinBuffer)
+                glDeleteBuffers(1, &arenas[i].skinBuffer);
+        }
+        arenas.clear();
+        ranges.clear();
+        freeHandles.clear();
+        boundVertexArray = 0;
+        generation++;
+    }
+
+private:
+    vector<GeometryArena> arenas;
+    vector<GeometryRange> ranges;
+    vector<Handle> freeHandles;
+    unsigned int boundVertexArray;
+    unsigned int generation;
+
+    GeometryPool() : boundVertexArray(0), generation(0)
+    {
+    }
+
+    GeometryPool(const GeometryPool &) = delete;
+    GeometryPool &operator=(const GeometryPool &) = delete;
+
+    // 16 bit indices take one unit each; 32 bit ones two, plus one so they can start 4 byte aligned
+    static unsigned int indexUnits(const GeometryRange &range)
+    {
+        return range.indexType == GL_UNSIGNED_SHORT ? range.indexCount : range.indexCount * 2 + 1;
+    }
+
+    static GLintptr indexOffset(const GeometryRange &range)
+    {
+        GLintptr offset = (GLintptr)range.indices.offset * 2;
+        return range.indexType == GL_UNSIGNED_SHORT ? offset : (offset + 3) & ~(GLintptr)3;
+    }
+
+    static void upload(unsigned int buffer, GLintptr offset, GLsizeiptr size, const void *data)
+    {
+        if (size == 0)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    static unsigned int createBuffer(GLsizeiptr size)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    // copies [source, source + size) of one buffer to 'target' in another
+    static void copy(unsigned int from, GLintptr source, unsigned int to, GLintptr target, GLsizeiptr size)
+    {
+        if (size == 0)
+            return;
+        glBindBuffer(GL_COPY_READ_BUFFER, from);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source, target, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    unsigned int arenaFor(const GeometryLayout &layout)
+    {
+        for (unsigned int i = 0; i < arenas.size(); i++)
+            if (arenas[i].layout.id == layout.id)
+                return i;
+
+        GeometryArena arena;
+        arena.layout = layout;
+        arena.vertices.Reset(INITIAL_VERTICES);
+        arena.indices.Reset(INITIAL_INDICES);
+        arena.vertexBuffer = createBuffer((GLsizeiptr)INITIAL_VERTICES * layout.stride);
+        arena.skinBuffer = layout.skinStride > 0 ? createBuffer((GLsizeiptr)INITIAL_VERTICES * layout.skinStride) : 0;
+        arena.indexBuffer = createBuffer((GLsizeiptr)INITIAL_INDICES * 2);
+        glGenVertexArrays(1, &arena.VAO);
+        arenas.push_back(arena);
+        setupVertexArray(static_cast<unsigned int>(arenas.size()) - 1);
+        return static_cast<unsigned int>(arenas.size()) - 1;
+    }
+
+    // points the arena's VAO at its current buffers
+    void setupVertexArray(unsigned int index)
+    {
+        GeometryArena &arena = arenas[index];
+        glBindVertexArray(arena.VAO);
+        arena.layout.setup(arena.vertexBuffer, arena.skinBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        boundVertexArray = 0;
+    }
+
+    // allocates from one of the arena's allocators; defragments, then grows the buffers if needed
+    OffsetAllocator::Allocation allocate(unsigned int arenaIndex, bool index, unsigned int size)
+    {
+        OffsetAllocator::Allocation allocation = { 0, OffsetAllocator::NO_SPACE };
+        if (size == 0)
+            return allocation;
+        OffsetAllocator &allocator = index ? arenas[arenaIndex].indices : arenas[arenaIndex].vertices;
+        allocation = allocator.Allocate(size);
+        if (allocation.offset != OffsetAllocator::NO_SPACE)
+            return allocation;
+
+        unsigned int vertices = arenas[arenaIndex].vertices.Size();
+        unsigned int indices = arenas[arenaIndex].indices.Size();
+        // fragmented: compacting is enough as long as the arena doesn't end up nearly full
+        if (allocator.FreeSpace() >= size && allocator.FreeSpace() - size >= allocator.Size() / 4)
+            defragment(arenaIndex, vertices, indices);
+        else
+        {
+            unsigned int &capacity = index ? indices : vertices;
+            unsigned int needed = allocator.Size() - allocator.FreeSpace() + size;
+            while (capacity < needed + needed / 4 && capacity < 0x40000000u)
+                capacity *= 2;
+            defragment(arenaIndex, vertices, indices);
+        }
+        OffsetAllocator &resized = index ? arenas[arenaIndex].indices : arenas[arenaIndex].vertices;
+        return resized.Allocate(size);
+    }
+
+    // rebuilds the arena with buffers of the given capacity and its live ranges packed at the front,
+    // in their current order; the data is moved on the GPU
+    void defragment(unsigned int arenaIndex, unsigned int vertexCapacity, unsigned int indexCapacity)
+    {
+        GeometryArena &arena = arenas[arenaIndex];
+        const GeometryLayout &layout = arena.layout;
+        vector<Handle> live;
+        for (Handle i = 0; i < ranges.size(); i++)
+            if (ranges[i].live && ranges[i].arena == arenaIndex)
+                live.push_back(i);
+        std::sort(live.begin(), live.end(), [this](Handle a, Handle b) { return ranges[a].vertices.offset < ranges[b].vertices.offset; });
+
+        unsigned int vertexBuffer = createBuffer((GLsizeiptr)vertexCapacity * layout.stride);
+        unsigned int skinBuffer = layout.skinStride > 0 ? createBuffer((GLsizeiptr)vertexCapacity * layout.skinStride) : 0;
+        unsigned int indexBuffer = createBuffer((GLsizeiptr)indexCapacity * 2);
+        arena.vertices.Reset(vertexCapacity);
+        arena.indices.Reset(indexCapacity);
+        // a range that is still being added may have no allocation of one kind yet (and no data)
+        for (unsigned int i = 0; i < live.size(); i++)
+        {
+            GeometryRange &range = ranges[live[i]];
+            if (range.vertices.offset != OffsetAllocator::NO_SPACE && range.vertexCount > 0)
+            {
+                GLintptr source = (GLintptr)range.vertices.offset;
+                range.vertices = arena.vertices.Allocate(range.vertexCount);
+                copy(arena.vertexBuffer, source * layout.stride, vertexBuffer, (GLintptr)range.vertices.offset * layout.stride, (GLsizeiptr)range.vertexCount * layout.stride);
+                if (skinBuffer)
+                    copy(arena.skinBuffer, source * layout.skinStride, skinBuffer, (GLintptr)range.vertices.offset * layout.skinStride, (GLsizeiptr)range.vertexCount * layout.skinStride);
+            }
+            if (range.indices.offset != OffsetAllocator::NO_SPACE && range.indexCount > 0)
+            {
+                GLintptr source = indexOffset(range);
+                range.indices = arena.indices.Allocate(indexUnits(range));
+                GLsizeiptr indexSize = (GLsizeiptr)range.indexCount * (range.indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+                copy(arena.indexBuffer, source, indexBuffer, indexOffset(range), indexSize);
+            }
+        }
+
+        glDeleteBuffers(1, &arena.vertexBuffer);
+        glDeleteBuffers(1, &arena.indexBuffer);
+        if (arena.skinBuffer)
+            glDeleteBuffers(1, &arena.skinBuffer);
+        arena.vertexBuffer = vertexBuffer;
+        arena.skinBuffer = skinBuffer;
+        arena.indexBuffer = indexBuffer;
+        setupVertexArray(arenaIndex);
+        generation++;
+    }
+};
+#endif
@@ -0,0 +1,166 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// glad is generated for a 3.3 core context. The entry points and enums of newer GL versions or
+// extensions that optional code paths use are declared here and loaded at runtime with the same
+// loader glad got. A feature flag stays false when the driver doesn't expose the feature, so
+// callers always keep their 3.3 path as the fallback.
+
+// GL 4.1 / ARB_get_program_binary
+#ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+#endif
+
+// KHR_parallel_shader_compile (or the ARB variant, same enums)
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+#endif
+
+// EXT_texture_compression_s3tc (+ the sRGB formats of EXT_texture_sRGB)
+#ifndef GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_EXT_texture_sRGB
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// GL 4.2 / ARB_texture_compression_bptc, ARB_texture_storage
+#ifndef GL_VERSION_4_2
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP PFNGLTEXSTORAGE3DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+#endif
+
+// GL 4.2 / ARB_shader_image_load_store, GL 4.3 / ARB_compute_shader, ARB_shader_storage_buffer_object,
+// ARB_multi_draw_indirect (with the indirect buffer of GL 4.0 / ARB_draw_indirect)
+#ifndef GL_VERSION_4_3
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+#endif
+
+struct GLExtensions {
+    // feature flags
+    bool programBinary;
+    bool parallelShaderCompile;
+    bool textureCompressionS3TC;
+    bool textureCompressionBPTC;
+    bool textureStorage;
+    // compute shaders writing shader storage buffers and images
+    bool computeShader;
+    bool multiDrawIndirect;
+    // entry points
+    PFNGLGETPROGRAMBINARYPROC  GetProgramBinary;
+    PFNGLPROGRAMBINARYPROC     ProgramBinary;
+    PFNGLPROGRAMPARAMETERIPROC ProgramParameteri;
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads;
+    PFNGLTEXSTORAGE2DPROC      TexStorage2D;
+    PFNGLTEXSTORAGE3DPROC      TexStorage3D;
+    PFNGLDISPATCHCOMPUTEPROC   DispatchCompute;
+    // not MemoryBarrier, which winnt.h defines as a macro on x64
+    PFNGLMEMORYBARRIERPROC     MemoryBarrierGL;
+    PFNGLBINDIMAGETEXTUREPROC  BindImageTexture;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+};
+
+// the loaded entry points; all null/false until loadGLExtensions ran
+inline GLExtensions &glExtensions()
+{
+    static GLExtensions extensions = {};
+    return extensions;
+}
+
+// checks the extension string list of the current context
+inline bool hasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool hasGLVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+// loads everything declared above; call once after gladLoadGLLoader with the same loader
+inline void loadGLExtensions(GLADloadproc load)
+{
+    GLExtensions &ext = glExtensions();
+
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        ext.GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        ext.ProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        ext.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+    }
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    ext.parallelShaderCompile = ext.MaxShaderCompilerThreads != NULL;
+    // let the driver pick as many compiler threads as it likes
+    if (ext.parallelShaderCompile)
+        ext.MaxShaderCompilerThreads(0xFFFFFFFFu);
+
+    // enums only; RGTC is core since 3.0
+    ext.textureCompressionS3TC = hasGLExtension("GL_EXT_texture_compression_s3tc");
+    ext.textureCompressionBPTC = hasGLVersion(4, 2) || hasGLExtension("GL_ARB_texture_compression_bptc");
+
+    if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_texture_storage"))
+    {
+        ext.TexStorage2D = (PFNGLTEXSTORAGE2DPROC)load("glTexStorage2D");
+        ext.TexStorage3D = (PFNGLTEXSTORAGE3DPROC)load("glTexStorage3D");
+        ext.textureStorage = ext.TexStorage2D && ext.TexStorage3D;
+    }
+
+    if (hasGLVersion(4, 3) || (hasGLExtension("GL_ARB_compute_shader") && hasGLExtension("GL_ARB_shader_storage_buffer_object") && hasGLExtension("GL_ARB_shader_image_load_store")))
+    {
+        ext.DispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+        ext.MemoryBarrierGL = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+        ext.BindImageTexture = (PFNGLBINDIMAGETEXTUREPROC)load("glBindImageTexture");
+        ext.computeShader = ext.DispatchCompute && ext.MemoryBarrierGL && ext.BindImageTexture;
+    }
+
+    // the draws of a multi-draw also need their baseInstance honoured (GL 4.2 / ARB_base_instance)
+    if (hasGLVersion(4, 3) || (hasGLExtension("GL_ARB_multi_draw_indirect") && hasGLExtension("GL_ARB_base_instance")))
+    {
+        ext.MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+        ext.multiDrawIndirect = ext.MultiDrawElementsIndirect != NULL;
+    }
+}
+#endif
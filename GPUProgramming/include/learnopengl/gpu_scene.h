@@ -0,0 +1,466 @@
+#ifndef GPU_SCENE_H
+#define GPU_SCENE_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/compute_shader.h>
+#include <learnopengl/geometry_pool.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// one object of a GpuScene as the shaders see it, std430 layout of GpuInstance in gpu_instances.glsl
+struct GpuInstance {
+    glm::mat4 model;
+    // object space bounding box of the mesh, w unused
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+    // index of the mesh's draw command
+    unsigned int command;
+    unsigned int padding[3];
+};
+
+// the layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Draws many placed copies of meshes whose culling cost doesn't grow on the CPU with their number.
+// With GL 4.3 (compute shaders and multi-draw indirect) every instance's transform and bounds live
+// in a shader storage buffer. Each frame cull.cs tests all instances against the frustum, and
+// against the depth pyramid of the previous frame, and appends the visible ones to the draw command
+// of their mesh. Draw then issues one glMultiDrawElementsIndirect per run of meshes that share an
+// arena, an index type and textures, so the CPU only sees a handful of draws. The vertex shader
+// (model_indirect.vs) reads the instance index from INSTANCE_ATTRIBUTE, which is fed per instance
+// from the visible list, offset by each command's baseInstance.
+// Without GL 4.3 the same calls cull on the CPU and draw every visible instance with a 'model'
+// uniform (model.vs), so callers pick the shader by Supported() and otherwise don't care.
+class GpuScene {
+public:
+    typedef unsigned int Instance;
+
+    // vertex attribute the instance index is fed to
+    static const GLuint INSTANCE_ATTRIBUTE = 7;
+    // shader storage binding points, see gpu_instances.glsl and cull.cs
+    static const GLuint INSTANCES_BINDING = 0;
+    static const GLuint COMMANDS_BINDING = 1;
+    static const GLuint VISIBLE_BINDING = 2;
+    // local sizes of cull.cs and depth_pyramid.cs
+    static const unsigned int CULL_GROUP_SIZE = 64;
+    static const unsigned int PYRAMID_GROUP_SIZE = 8;
+
+    // true if the GPU driven path is available
+    static bool Supported()
+    {
+        return glExtensions().computeShader && glExtensions().multiDrawIndirect;
+    }
+
+    GpuScene() : gpu(Supported()), dirty(true), poolGeneration(0), instanceBuffer(0), commandBuffer(0), visibleBuffer(0),
+        depthTexture(0), depthFramebuffer(0), pyramidTexture(0), pyramidWidth(0), pyramidHeight(0), pyramidLevels(0), hasPyramid(false),
+        cullViewProjection(1.0f), pyramidViewProjection(1.0f)
+    {
+        if (!gpu)
+            return;
+        cullShader.reset(new ComputeShader("shader/cull.cs"));
+        pyramidShader.reset(new ComputeShader("shader/depth_pyramid.cs"));
+        glGenBuffers(1, &instanceBuffer);
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &visibleBuffer);
+    }
+
+    GpuScene(const GpuScene &) = delete;
+    GpuScene &operator=(const GpuScene &) = delete;
+
+    // places 'mesh' with 'transform'. The mesh has to outlive the scene (or the next Clear).
+    Instance Add(Mesh &mesh, const glm::mat4 &transform)
+    {
+        GpuInstance instance;
+        instance.model = transform;
+        instance.boundsMin = glm::vec4(mesh.boundsMin, 1.0f);
+        instance.boundsMax = glm::vec4(mesh.boundsMax, 1.0f);
+        instance.command = 0;
+        instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+        instances.push_back(instance);
+        meshes.push_back(&mesh);
+        dirty = true;
+        return static_cast<Instance>(instances.size()) - 1;
+    }
+
+    // places every mesh of a model (Model::meshes) with the same transform; returns the first instance
+    Instance Add(vector<Mesh> &modelMeshes, const glm::mat4 &transform)
+    {
+        Instance first = static_cast<Instance>(instances.size());
+        for (unsigned int i = 0; i < modelMeshes.size(); i++)
+            Add(modelMeshes[i], transform);
+        return first;
+    }
+
+    void SetTransform(Instance instance, const glm::mat4 &transform)
+    {
+        instances[instance].model = transform;
+        // after the next rebuild the whole buffer is uploaded anyway
+        if (gpu && !dirty)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)instance * sizeof(GpuInstance), sizeof(glm::mat4), &transform);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+    }
+
+    unsigned int InstanceCount() const
+    {
+        return static_cast<unsigned int>(instances.size());
+    }
+
+    // removes every instance
+    void Clear()
+    {
+        instances.clear();
+        meshes.clear();
+        visible.clear();
+        dirty = true;
+    }
+
+    // decides which instances are drawn this frame. On the GPU path the previous frame's depth
+    // pyramid (UpdateDepthPyramid) also rejects instances that were hidden behind it.
+    void Cull(const glm::mat4 &viewProjection)
+    {
+        cullViewProjection = viewProjection;
+        if (!gpu)
+        {
+            visible.clear();
+            for (unsigned int i = 0; i < instances.size(); i++)
+                if (meshes[i]->geometry != GeometryPool::INVALID_HANDLE && inFrustum(viewProjection * instances[i].model, instances[i]))
+                    visible.push_back(i);
+            return;
+        }
+
+        if (dirty || poolGeneration != GeometryPool::Get().Generation())
+            rebuild();
+        if (commands.empty())
+            return;
+        // every frame starts with empty commands; the shader counts the visible instances up
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        cullShader->use();
+        cullShader->setUint("instanceCount", static_cast<unsigned int>(instances.size()));
+        cullShader->setUint("commandCount", static_cast<unsigned int>(commands.size()));
+        cullShader->setMat4("viewProjection", viewProjection);
+        cullShader->setInt("occlusion", hasPyramid ? 1 : 0);
+        if (hasPyramid)
+        {
+            cullShader->setMat4("previousViewProjection", pyramidViewProjection);
+            cullShader->setInt("depthPyramidLevels", pyramidLevels);
+            cullShader->setInt("depthPyramid", 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCES_BINDING, instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, visibleBuffer);
+        cullShader->Dispatch((static_cast<unsigned int>(instances.size()) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+        if (hasPyramid)
+            Material::InvalidateBindings();
+        // the commands are read by the draws, the visible list as an instanced vertex attribute
+        glExtensions().MemoryBarrierGL(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // draws what the last Cull left visible. 'shader' is built from model_indirect.vs on the GPU
+    // path and from model.vs otherwise. Leaves no vertex array bound.
+    void Draw(Shader &shader)
+    {
+        if (!gpu)
+        {
+            for (unsigned int i = 0; i < visible.size(); i++)
+            {
+                shader.setMat4("model", instances[visible[i]].model);
+                meshes[visible[i]]->Draw(shader);
+            }
+            GeometryPool::Get().Unbind();
+            return;
+        }
+
+        if (commands.empty())
+            return;
+        GeometryPool &pool = GeometryPool::Get();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCES_BINDING, instanceBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        for (unsigned int i = 0; i < batches.size(); i++)
+        {
+            const Batch &batch = batches[i];
+            Mesh &mesh = *commandMeshes[batch.firstCommand];
+            mesh.BindMaterial(shader);
+            pool.Bind(mesh.geometry);
+            // the arena VAOs are shared with plain draws, so the attribute is only enabled for these
+            glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE);
+            glVertexAttribIPointer(INSTANCE_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE, 1);
+            glExtensions().MultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType, (void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)),
+                (GLsizei)batch.commandCount, sizeof(DrawElementsIndirectCommand));
+            glDisableVertexAttribArray(INSTANCE_ATTRIBUTE);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        pool.Unbind();
+    }
+
+    // keeps the depth of the frame just drawn for the occlusion test of the next Cull: the depth of
+    // 'framebuffer' (0 for the default one) is copied and reduced to a pyramid whose texels hold the
+    // farthest depth below them. The copy is a blit, so the framebuffer's depth has to be
+    // GL_DEPTH24_STENCIL8, which is what the default framebuffer usually has. Nothing on the 3.3 path.
+    void UpdateDepthPyramid(GLuint framebuffer, int width, int height)
+    {
+        if (!gpu || width <= 0 || height <= 0)
+            return;
+        if (width != pyramidWidth || height != pyramidHeight)
+            createPyramid(width, height);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFramebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+        // level 0 is a copy of the depth, every further level reduces the one above it
+        pyramidShader->use();
+        pyramidShader->setInt("source", 0);
+        glActiveTexture(GL_TEXTURE0);
+        for (int level = 0; level < pyramidLevels; level++)
+        {
+            glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : pyramidTexture);
+            pyramidShader->setInt("sourceLevel", level == 0 ? 0 : level - 1);
+            pyramidShader->setIvec2("sourceSize", glm::ivec2(std::max(width >> std::max(level - 1, 0), 1), std::max(height >> std::max(level - 1, 0), 1)));
+            glExtensions().BindImageTexture(0, pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            pyramidShader->Dispatch((levelWidth + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (levelHeight + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE);
+            glExtensions().MemoryBarrierGL(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        Material::InvalidateBindings();
+        pyramidViewProjection = cullViewProjection;
+        hasPyramid = true;
+    }
+
+    // forgets the depth pyramid, e.g. after a camera cut, until the next UpdateDepthPyramid
+    void ResetDepthPyramid()
+    {
+        hasPyramid = false;
+    }
+
+    void Release()
+    {
+        Clear();
+        commands.clear();
+        commandMeshes.clear();
+        batches.clear();
+        if (!gpu)
+            return;
+        cullShader->Release();
+        pyramidShader->Release();
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &visibleBuffer);
+        deletePyramid();
+        instanceBuffer = commandBuffer = visibleBuffer = 0;
+    }
+
+private:
+    // consecutive commands drawn by one glMultiDrawElementsIndirect
+    struct Batch {
+        unsigned int firstCommand;
+        unsigned int commandCount;
+        GLenum indexType;
+    };
+
+    bool gpu;
+    vector<GpuInstance> instances;
+    vector<Mesh *> meshes;
+    // CPU path: the instances that passed the last Cull
+    vector<unsigned int> visible;
+
+    // GPU path: one command per distinct mesh, with instanceCount 0, and the mesh it draws
+    vector<DrawElementsIndirectCommand> commands;
+    vector<Mesh *> commandMeshes;
+    vector<Batch> batches;
+    bool dirty;
+    unsigned int poolGeneration;
+    std::unique_ptr<ComputeShader> cullShader;
+    std::unique_ptr<ComputeShader> pyramidShader;
+    unsigned int instanceBuffer;
+    unsigned int commandBuffer;
+    unsigned int visibleBuffer;
+
+    unsigned int depthTexture;
+    unsigned int depthFramebuffer;
+    unsigned int pyramidTexture;
+    int pyramidWidth, pyramidHeight, pyramidLevels;
+    bool hasPyramid;
+    // the camera of the last Cull, and of the frame the pyramid was taken from
+    glm::mat4 cullViewProjection;
+    glm::mat4 pyramidViewProjection;
+
+    // the same test cull.cs does: outside if all eight corners of the box are beyond one clip plane
+    static bool inFrustum(const glm::mat4 &modelViewProjection, const GpuInstance &instance)
+    {
+        int outside[6] = { 0, 0, 0, 0, 0, 0 };
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec4 corner((i & 1) ? instance.boundsMax.x : instance.boundsMin.x,
+                             (i & 2) ? instance.boundsMax.y : instance.boundsMin.y,
+                             (i & 4) ? instance.boundsMax.z : instance.boundsMin.z, 1.0f);
+            glm::vec4 clip = modelViewProjection * corner;
+            outside[0] += clip.x < -clip.w;
+            outside[1] += clip.x > clip.w;
+            outside[2] += clip.y < -clip.w;
+            outside[3] += clip.y > clip.w;
+            outside[4] += clip.z < -clip.w;
+            outside[5] += clip.z > clip.w;
+        }
+        for (int plane = 0; plane < 6; plane++)
+            if (outside[plane] == 8)
+                return false;
+        return true;
+    }
+
+    // true if a and b can be drawn by the same multi-draw: same vertex array, index type and textures
+    static bool sameBatch(const Mesh &a, const Mesh &b)
+    {
+        if (GeometryPool::Get().VertexArray(a.geometry) != GeometryPool::Get().VertexArray(b.geometry) || a.indexType != b.indexType
+            || a.textures.size() != b.textures.size())
+            return false;
+        for (unsigned int i = 0; i < a.textures.size(); i++)
+            if (a.textures[i].id != b.textures[i].id || a.textures[i].type != b.textures[i].type)
+                return false;
+        return true;
+    }
+
+    static bool batchOrder(const Mesh *a, const Mesh *b)
+    {
+        unsigned int vaoA = GeometryPool::Get().VertexArray(a->geometry), vaoB = GeometryPool::Get().VertexArray(b->geometry);
+        if (vaoA != vaoB)
+            return vaoA < vaoB;
+        if (a->indexType != b->indexType)
+            return a->indexType < b->indexType;
+        if (a->textures.size() != b->textures.size())
+            return a->textures.size() < b->textures.size();
+        for (unsigned int i = 0; i < a->textures.size(); i++)
+            if (a->textures[i].id != b->textures[i].id)
+                return a->textures[i].id < b->textures[i].id;
+        return a < b;
+    }
+
+    // one command per distinct mesh, ordered so meshes of a batch are adjacent, and every instance
+    // pointed at its command. The instances of a command get consecutive slots of the visible list,
+    // starting at its baseInstance.
+    void rebuild()
+    {
+        GeometryPool &pool = GeometryPool::Get();
+        commandMeshes.clear();
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            if (meshes[i]->geometry != GeometryPool::INVALID_HANDLE)
+                commandMeshes.push_back(meshes[i]);
+        std::sort(commandMeshes.begin(), commandMeshes.end(), batchOrder);
+        commandMeshes.erase(std::unique(commandMeshes.begin(), commandMeshes.end()), commandMeshes.end());
+
+        // instances of meshes without geometry point past the last command and are never drawn
+        vector<unsigned int> instanceCounts(commandMeshes.size() + 1, 0);
+        for (unsigned int i = 0; i < instances.size(); i++)
+        {
+            vector<Mesh *>::iterator it = std::lower_bound(commandMeshes.begin(), commandMeshes.end(), meshes[i], batchOrder);
+            bool found = it != commandMeshes.end() && *it == meshes[i];
+            instances[i].command = found ? static_cast<unsigned int>(it - commandMeshes.begin()) : static_cast<unsigned int>(commandMeshes.size());
+            instanceCounts[instances[i].command]++;
+        }
+
+        commands.resize(commandMeshes.size());
+        batches.clear();
+        GLuint baseInstance = 0;
+        for (unsigned int i = 0; i < commandMeshes.size(); i++)
+        {
+            const Mesh &mesh = *commandMeshes[i];
+            const GeometryRange &range = pool.Range(mesh.geometry);
+            DrawElementsIndirectCommand &command = commands[i];
+            command.count = range.indexCount;
+            command.instanceCount = 0;
+            command.firstIndex = static_cast<GLuint>(pool.IndexOffset(mesh.geometry) / (range.indexType == GL_UNSIGNED_SHORT ? 2 : 4));
+            command.baseVertex = static_cast<GLint>(range.vertices.offset);
+            command.baseInstance = baseInstance;
+            baseInstance += instanceCounts[i];
+
+            if (batches.empty() || !sameBatch(*commandMeshes[batches.back().firstCommand], mesh))
+            {
+                Batch batch = { i, 0, range.indexType };
+                batches.push_back(batch);
+            }
+            batches.back().commandCount++;
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(instances.size(), (size_t)1) * sizeof(GpuInstance), instances.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(instances.size(), (size_t)1) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(commands.size(), (size_t)1) * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        dirty = false;
+        poolGeneration = pool.Generation();
+    }
+
+    void createPyramid(int width, int height)
+    {
+        deletePyramid();
+        pyramidWidth = width;
+        pyramidHeight = height;
+        pyramidLevels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2)
+            pyramidLevels++;
+
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glGenFramebuffers(1, &depthFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenTextures(1, &pyramidTexture);
+        glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+        for (int level = 0; level < pyramidLevels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(width >> level, 1), std::max(height >> level, 1), 0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pyramidLevels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        hasPyramid = false;
+    }
+
+    void deletePyramid()
+    {
+        if (depthTexture)
+            glDeleteTextures(1, &depthTexture);
+        if (depthFramebuffer)
+            glDeleteFramebuffers(1, &depthFramebuffer);
+        if (pyramidTexture)
+            glDeleteTextures(1, &pyramidTexture);
+        depthTexture = depthFramebuffer = pyramidTexture = 0;
+        pyramidWidth = pyramidHeight = pyramidLevels = 0;
+        hasPyramid = false;
+    }
+};
+#endif
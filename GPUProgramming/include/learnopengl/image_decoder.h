@@ -0,0 +1,287 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/thread_pool.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Per thread bump allocator behind stb_image's STBI_MALLOC/STBI_REALLOC_SIZED/STBI_FREE. Route them
+// here where the implementation is compiled (src/stb_image.cpp):
+//
+//   #define STBI_MALLOC(size)                   ImageArena::Malloc(size)
+//   #define STBI_REALLOC_SIZED(p, oldSize, newSize) ImageArena::Realloc(p, oldSize, newSize)
+//   #define STBI_FREE(p)                        ImageArena::Free(p)
+//   #define STBI_PARALLEL_FOR(count, job, context) ImageDecoder::ParallelFor(count, job, context)
+//   #define STB_IMAGE_IMPLEMENTATION
+//   #include <stb_image.h>
+//
+// Outside of a Scope every allocation goes to the heap as usual. Inside one, the decoder's scratch
+// buffers come from the thread's arena, which keeps its memory between decodes, so a worker stops
+// churning through malloc/free for every image; all of it is released at once when the Scope ends,
+// so nothing allocated inside may outlive it. A Scope can also be given an output buffer: the first
+// allocation of exactly its size is placed there, which is how stb_image ends up decoding straight
+// into a caller's buffer.
+class ImageArena {
+public:
+    class Scope {
+    public:
+        Scope(unsigned char *output = NULL, size_t outputSize = 0)
+        {
+            State &state = threadState();
+            previousOutput = state.output;
+            previousOutputSize = state.outputSize;
+            previousOutputTaken = state.outputTaken;
+            state.depth++;
+            state.output = output;
+            state.outputSize = outputSize;
+            state.outputTaken = false;
+        }
+
+        ~Scope()
+        {
+            State &state = threadState();
+            state.output = previousOutput;
+            state.outputSize = previousOutputSize;
+            state.outputTaken = previousOutputTaken;
+            if (--state.depth == 0)
+                state.reset();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        unsigned char *previousOutput;
+        size_t previousOutputSize;
+        bool previousOutputTaken;
+    };
+
+    static void *Malloc(size_t size)
+    {
+        State &state = threadState();
+        if (state.depth > 0 && state.output && !state.outputTaken && size == state.outputSize)
+        {
+            state.outputTaken = true;
+            return state.output;
+        }
+        Header *header;
+        if (state.depth > 0)
+            header = state.allocate(sizeof(Header) + size);
+        else
+            header = (Header *)std::malloc(sizeof(Header) + size);
+        if (!header)
+            return NULL;
+        header->size = size;
+        header->fromArena = state.depth > 0;
+        return header + 1;
+    }
+
+    static void *Realloc(void *pointer, size_t oldSize, size_t newSize)
+    {
+        if (!pointer)
+            return Malloc(newSize);
+        State &state = threadState();
+        if (pointer == state.output)
+            oldSize = state.outputSize;
+        else
+        {
+            Header *header = (Header *)pointer - 1;
+            oldSize = header->size;
+            // the newest arena block can simply grow
+            if (header->fromArena && state.grow(header, sizeof(Header) + newSize))
+            {
+                header->size = newSize;
+                return pointer;
+            }
+        }
+        void *moved = Malloc(newSize);
+        if (moved)
+            std::memcpy(moved, pointer, std::min(oldSize, newSize));
+        Free(pointer);
+        return moved;
+    }
+
+    static void Free(void *pointer)
+    {
+        if (!pointer)
+            return;
+        State &state = threadState();
+        if (pointer == state.output)
+        {
+            state.outputTaken = false;
+            return;
+        }
+        Header *header = (Header *)pointer - 1;
+        // arena blocks are reclaimed together when the scope ends
+        if (!header->fromArena)
+            std::free(header);
+    }
+
+private:
+    // in front of every block; 16 bytes so the data keeps malloc's alignment
+    struct Header {
+        size_t size;
+        size_t fromArena;
+#if SIZE_MAX == 0xFFFFFFFFu
+        size_t padding[2];
+#endif
+    };
+
+    struct State {
+        std::vector<unsigned char *> chunks;
+        std::vector<size_t> chunkSizes;
+        size_t used; // bytes used in the last chunk
+        size_t last; // offset of the newest block in the last chunk
+        int depth;
+        unsigned char *output;
+        size_t outputSize;
+        bool outputTaken;
+
+        State() : used(0), last(0), depth(0), output(NULL), outputSize(0), outputTaken(false)
+        {
+        }
+
+        ~State()
+        {
+            for (unsigned int i = 0; i < chunks.size(); i++)
+                std::free(chunks[i]);
+        }
+
+        Header *allocate(size_t size)
+        {
+            size = (size + 15) & ~(size_t)15;
+            if (chunks.empty() || used + size > chunkSizes.back())
+            {
+                size_t chunkSize = std::max(size, chunks.empty() ? (size_t)1 << 20 : chunkSizes.back() * 2);
+                unsigned char *chunk = (unsigned char *)std::malloc(chunkSize);
+                if (!chunk)
+                    return NULL;
+                chunks.push_back(chunk);
+                chunkSizes.push_back(chunkSize);
+                used = 0;
+            }
+            last = used;
+            used += size;
+            return (Header *)(chunks.back() + last);
+        }
+
+        bool grow(Header *header, size_t size)
+        {
+            size = (size + 15) & ~(size_t)15;
+            if (chunks.empty() || (unsigned char *)header != chunks.back() + last || last + size > chunkSizes.back())
+                return false;
+            used = last + size;
+            return true;
+        }
+
+        // one decode needed all chunks together; merge them so the next one fits in a single chunk
+        void reset()
+        {
+            if (chunks.size() > 1)
+            {
+                size_t total = 0;
+                for (unsigned int i = 0; i < chunks.size(); i++)
+                {
+                    total += chunkSizes[i];
+                    std::free(chunks[i]);
+                }
+                chunks.assign(1, (unsigned char *)std::malloc(total));
+                chunkSizes.assign(1, total);
+                if (!chunks[0])
+                {
+                    chunks.clear();
+                    chunkSizes.clear();
+                }
+            }
+            used = 0;
+            last = 0;
+        }
+    };
+
+    static State &threadState()
+    {
+        static thread_local State state;
+        return state;
+    }
+};
+
+// Decodes images from memory, usually a MappedFile, so the file bytes are never copied through
+// stdio. DecodeInto writes the pixels into a caller's buffer. With a thread pool set, stb_image
+// splits large JPEGs into jobs that run on the pool (see STBI_PARALLEL_FOR above).
+class ImageDecoder {
+public:
+    // pool that helps decoding single images; NULL decodes every image on its calling thread
+    static void SetThreadPool(ThreadPool *pool)
+    {
+        threadPool().store(pool);
+    }
+
+    // runs job(context, i) for every i in [0, count) and returns once all of them finished, see
+    // ThreadPool::ParallelFor
+    static void ParallelFor(int count, void (*job)(void *, int), void *context)
+    {
+        ThreadPool *pool = threadPool().load();
+        if (!pool)
+        {
+            for (int i = 0; i < count; i++)
+                job(context, i);
+            return;
+        }
+        pool->ParallelFor(count, [job, context](int i) { job(context, i); });
+    }
+
+    // reads the size and component count from the header without decoding
+    static bool Info(const MappedFile &file, int &width, int &height, int &components)
+    {
+        return file.Data() && stbi_info_from_memory(file.Data(), (int)file.Size(), &width, &height, &components) != 0;
+    }
+
+    // decodes with 'desiredComponents' channels (0 keeps the file's). Inside an ImageArena::Scope the
+    // pixels live in the arena until the scope ends; release them with stbi_image_free either way.
+    static unsigned char *Decode(const MappedFile &file, int &width, int &height, int &components, int desiredComponents = 0)
+    {
+        if (!file.Data())
+            return NULL;
+        return stbi_load_from_memory(file.Data(), (int)file.Size(), &width, &height, &components, desiredComponents);
+    }
+
+    // decodes with 'components' channels (0 keeps the file's) into 'destination', which must hold
+    // exactly width * height * channels bytes. If stb_image places its output buffer there (see
+    // ImageArena) nothing is copied at all, otherwise its result is copied once. The PNG filters read
+    // back the previous row, so the destination has to be readable (map a PBO with GL_MAP_READ_BIT too).
+    static bool DecodeInto(const MappedFile &file, unsigned char *destination, size_t destinationSize, int components = 0)
+    {
+        ImageArena::Scope scope(destination, destinationSize);
+        int width, height, fileComponents;
+        unsigned char *pixels = file.Data() ? stbi_load_from_memory(file.Data(), (int)file.Size(), &width, &height, &fileComponents, components) : NULL;
+        if (!pixels)
+            return false;
+        size_t size = (size_t)width * height * (components ? components : fileComponents);
+        if (size != destinationSize)
+        {
+            stbi_image_free(pixels);
+            return false;
+        }
+        if (pixels != destination)
+        {
+            std::memcpy(destination, pixels, size);
+            stbi_image_free(pixels);
+        }
+        return true;
+    }
+
+private:
+    static std::atomic<ThreadPool *> &threadPool()
+    {
+        static std::atomic<ThreadPool *> pool(NULL);
+        return pool;
+    }
+};
+#endif
@@ -0,0 +1,87 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+// Per-instance transforms for instanced draws. Every draw's matrices are appended to one streaming
+// vertex buffer; when it is full it is orphaned (glBufferData with NULL) and filled from the start
+// again, so the driver never has to wait for draws that still read the old contents. The matrices of
+// a draw are fed to INSTANCE_MATRIX_ATTRIBUTE .. +3 with divisor 1 (see model_instanced.vs).
+class InstanceBuffer {
+public:
+    // a mat4 takes four consecutive attribute locations; 7 is GpuScene's instance index
+    static const GLuint INSTANCE_MATRIX_ATTRIBUTE = 8;
+    static const GLsizeiptr INITIAL_SIZE = 1024 * sizeof(glm::mat4);
+
+    static InstanceBuffer &Get()
+    {
+        static InstanceBuffer buffer;
+        return buffer;
+    }
+
+    // copies the transforms into the buffer and returns where they start, for Bind
+    GLintptr Upload(const glm::mat4 *transforms, unsigned int count)
+    {
+        GLsizeiptr size = (GLsizeiptr)count * sizeof(glm::mat4);
+        if (!VBO)
+            glGenBuffers(1, &VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        if (offset + size > capacity)
+        {
+            if (capacity < INITIAL_SIZE)
+                capacity = INITIAL_SIZE;
+            while (capacity < size)
+                capacity *= 2;
+            glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+            offset = 0;
+        }
+        GLintptr start = offset;
+        glBufferSubData(GL_COPY_WRITE_BUFFER, start, size, transforms);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        offset += size;
+        return start;
+    }
+
+    // points the instance attributes of the bound vertex array at the matrices uploaded at 'start'
+    void Bind(GLintptr start)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        for (GLuint i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + i);
+            glVertexAttribPointer(INSTANCE_MATRIX_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(start + i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MATRIX_ATTRIBUTE + i, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // disables the instance attributes again; the vertex arrays are shared with non-instanced draws
+    void Unbind()
+    {
+        for (GLuint i = 0; i < 4; i++)
+            glDisableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + i);
+    }
+
+    void Release()
+    {
+        if (VBO)
+            glDeleteBuffers(1, &VBO);
+        VBO = 0;
+        capacity = offset = 0;
+    }
+
+private:
+    unsigned int VBO;
+    GLsizeiptr capacity;
+    GLintptr offset;
+
+    InstanceBuffer() : VBO(0), capacity(0), offset(0)
+    {
+    }
+
+    InstanceBuffer(const InstanceBuffer &) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+};
+#endif
@@ -0,0 +1,128 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A read only memory mapping of a whole file. Decoders read the bytes straight from the page
+// cache instead of copying them through stdio buffers. Move only; the mapping is released with
+// the object.
+class MappedFile {
+public:
+    MappedFile() : data(NULL), size(0)
+    {
+    }
+
+    explicit MappedFile(const std::string &path) : data(NULL), size(0)
+    {
+        Open(path);
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) : data(other.data), size(other.size)
+    {
+        other.data = NULL;
+        other.size = 0;
+    }
+
+    MappedFile &operator=(MappedFile &&other)
+    {
+        if (this != &other)
+        {
+            Close();
+            data = other.data;
+            size = other.size;
+            other.data = NULL;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    // maps 'path'; false if it doesn't exist, can't be read or is empty
+    bool Open(const std::string &path)
+    {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (data)
+                size = (size_t)fileSize.QuadPart;
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+#else
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat info;
+        if (fstat(file, &info) == 0 && info.st_size > 0)
+        {
+            void *mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED)
+            {
+                data = (const unsigned char *)mapping;
+                size = (size_t)info.st_size;
+            }
+        }
+        close(file);
+#endif
+        return data != NULL;
+    }
+
+    void Close()
+    {
+        if (!data)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap((void *)data, size);
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+    const unsigned char *Data() const
+    {
+        return data;
+    }
+
+    size_t Size() const
+    {
+        return size;
+    }
+
+private:
+    const unsigned char *data;
+    size_t size;
+};
+#endif
@@ -0,0 +1,110 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/shader.h>
+
+#include <string>
+#include <vector>
+using namespace std;
+
+#define MAX_MATERIAL_TEXTURE_UNITS 32
+
+struct Texture {
+    unsigned int id;
+    string type;
+    string path;
+};
+
+// one texture bound to the unit of the sampler it feeds
+struct MaterialBinding {
+    unsigned int unit;
+    unsigned int texture;
+};
+
+// The textures of a mesh resolved against one shader: which texture goes to which unit. Built once,
+// so drawing does no name building and no uniform calls. The sampler uniforms themselves point at
+// fixed units since link time (see Shader::samplerUnit).
+class Material {
+public:
+    unsigned int program;
+    vector<MaterialBinding> bindings;
+
+    // resolves the textures against the shader's samplers. We assume the sampler naming convention
+    // 'texture_diffuseN', 'texture_specularN', 'texture_normalN', 'texture_heightN' with N counting from 1
+    // per type in the order the textures are listed. Textures without a matching sampler are dropped.
+    Material(const vector<Texture> &textures, const Shader &shader) : program(shader.ID)
+    {
+        unsigned int diffuseNr  = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr   = 1;
+        unsigned int heightNr   = 1;
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            // retrieve texture number (the N in diffuse_textureN)
+            string number;
+            const string &name = textures[i].type;
+            if (name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "texture_specular")
+                number = std::to_string(specularNr++);
+            else if (name == "texture_normal")
+                number = std::to_string(normalNr++);
+            else if (name == "texture_height")
+                number = std::to_string(heightNr++);
+
+            GLint unit = shader.samplerUnit(name + number);
+            if (unit < 0 || unit >= MAX_MATERIAL_TEXTURE_UNITS)
+                continue;
+            MaterialBinding binding;
+            binding.unit = static_cast<unsigned int>(unit);
+            binding.texture = textures[i].id;
+            bindings.push_back(binding);
+        }
+    }
+
+    // binds the textures, skipping every unit that already holds the right texture
+    void Bind() const
+    {
+        unsigned int *bound = boundTextures();
+        bool switchedUnit = false;
+        for (unsigned int i = 0; i < bindings.size(); i++)
+        {
+            const MaterialBinding &binding = bindings[i];
+            if (bound[binding.unit] == binding.texture)
+                continue;
+            glActiveTexture(GL_TEXTURE0 + binding.unit);
+            glBindTexture(GL_TEXTURE_2D, binding.texture);
+            bound[binding.unit] = binding.texture;
+            switchedUnit = true;
+        }
+        // always good practice to set everything back to defaults once configured.
+        if (switchedUnit)
+            glActiveTexture(GL_TEXTURE0);
+    }
+
+    // forgets the tracked GL_TEXTURE_2D bindings. Call this after binding 2D textures outside of Material.
+    static void InvalidateBindings()
+    {
+        unsigned int *bound = boundTextures();
+        for (unsigned int i = 0; i < MAX_MATERIAL_TEXTURE_UNITS; i++)
+            bound[i] = 0xFFFFFFFFu;
+    }
+
+private:
+    // GL_TEXTURE_2D binding of every unit as last set by a Material
+    static unsigned int *boundTextures()
+    {
+        static unsigned int bound[MAX_MATERIAL_TEXTURE_UNITS];
+        static bool initialized = false;
+        if (!initialized)
+        {
+            for (unsigned int i = 0; i < MAX_MATERIAL_TEXTURE_UNITS; i++)
+                bound[i] = 0xFFFFFFFFu;
+            initialized = true;
+        }
+        return bound;
+    }
+};
+#endif
@@ -5,10 +5,15 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <learnopengl/geometry_pool.h>
+#include <learnopengl/instance_buffer.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/material.h>
 
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -31,10 +36,33 @@ struct Vertex {
 	float m_Weights[MAX_BONE_INFLUENCE];
 };
 
-struct Texture {
-    unsigned int id;
-    string type;
-    string path;
+// how a Mesh stores its vertices on the GPU. The attribute locations are the same for both formats.
+enum VertexFormat {
+    // every Vertex member as is (88 bytes)
+    VERTEX_FORMAT_FULL,
+    // 24 byte PackedVertex stream (position, 10:10:10:2 normal/tangent, half float uv) plus an 8 byte
+    // SkinVertex stream that only skinned meshes get. The bitangent is not stored and location 4 stays
+    // disabled: a normal mapping vertex shader drawing this format has to rebuild it itself as
+    // cross(normal, tangent.xyz) * tangent.w. None of the shaders in shader/ sample normal maps yet.
+    VERTEX_FORMAT_COMPRESSED
+};
+
+struct PackedVertex {
+    // position
+    glm::vec3 Position;
+    // normal, GL_INT_2_10_10_10_REV
+    glm::uint32 Normal;
+    // tangent, GL_INT_2_10_10_10_REV with the bitangent sign in w
+    glm::uint32 Tangent;
+    // texCoords, two half floats
+    glm::uint32 TexCoords;
+};
+
+struct SkinVertex {
+    // bone indexes, at most 256 bones per mesh
+    unsigned char BoneIDs[MAX_BONE_INFLUENCE];
+    // weights, normalized to 0..1
+    unsigned char Weights[MAX_BONE_INFLUENCE];
 };
 
 class Mesh {
@@ -43,81 +71,234 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // the vertex array shared by all meshes of the same format, see GeometryPool
     unsigned int VAO;
+    VertexFormat format;
+    unsigned int indexCount;
+    // GL_UNSIGNED_SHORT when every vertex is reachable with 16 bits, GL_UNSIGNED_INT otherwise
+    GLenum indexType;
+    // the mesh's vertices and indices in the geometry pool
+    GeometryPool::Handle geometry;
+    // object space bounding box of the vertex positions, for culling
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes ownership of the data. With releaseCpuData the vertex/index arrays are freed
+    // once they're uploaded; only the GPU copies (and the textures) stay resident.
+    Mesh(vector<Vertex> &&vertices, vector<unsigned int> &&indices, vector<Texture> &&textures, VertexFormat format = VERTEX_FORMAT_FULL, bool releaseCpuData = false)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        indexCount = static_cast<unsigned int>(this->indices.size());
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
+
+        if (releaseCpuData)
+        {
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // like the constructor above, but 'buffers' already holds the data in the layout of 'format'
+    // (vertices itself or their Pack result), e.g. converted on a worker thread so only the upload is left
+    Mesh(vector<Vertex> &&vertices, vector<unsigned int> &&indices, vector<Texture> &&textures, const MeshBuffers &buffers, VertexFormat format, bool releaseCpuData)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        indexCount = buffers.indexCount;
+        upload(buffers);
+
+        if (releaseCpuData)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
         }
+    }
+
+    // uploads data that is already in the layout of 'format'; the mesh keeps no CPU copy
+    Mesh(const MeshBuffers &buffers, vector<Texture> &&textures, VertexFormat format)
+        : textures(std::move(textures)), format(format)
+    {
+        indexCount = buffers.indexCount;
+        upload(buffers);
+    }
+
+    // meshes own GL objects and potentially large arrays, so they're only ever moved
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
+
+    // render the mesh. The vertex array of the mesh's arena stays bound, so meshes of one format draw
+    // back to back without rebinding; call GeometryPool::Get().Unbind() after a run of draws.
+    void Draw(Shader &shader) 
+    {
+        // bind appropriate textures through the binding table resolved for this shader
+        BindMaterial(shader);
         
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        GeometryPool::Get().Draw(geometry);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // draws 'count' copies of the mesh in one call. transforms[i] takes the place of the 'model' uniform for
+    // copy i; the shader reads it from InstanceBuffer::INSTANCE_MATRIX_ATTRIBUTE (see model_instanced.vs).
+    // Leaves the arena's vertex array bound like Draw.
+    void DrawInstanced(Shader &shader, const glm::mat4 *transforms, unsigned int count)
+    {
+        if (count == 0 || geometry == GeometryPool::INVALID_HANDLE)
+            return;
+        DrawInstanced(shader, InstanceBuffer::Get().Upload(transforms, count), count);
+    }
+
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &transforms)
+    {
+        DrawInstanced(shader, transforms.data(), static_cast<unsigned int>(transforms.size()));
+    }
+
+    // the same with transforms that InstanceBuffer::Upload already returned 'instances' for, e.g. shared
+    // by all meshes of a model
+    void DrawInstanced(Shader &shader, GLintptr instances, unsigned int count)
+    {
+        if (count == 0 || geometry == GeometryPool::INVALID_HANDLE)
+            return;
+        BindMaterial(shader);
+        GeometryPool::Get().Bind(geometry);
+        InstanceBuffer::Get().Bind(instances);
+        GeometryPool::Get().DrawInstanced(geometry, count);
+        InstanceBuffer::Get().Unbind();
+    }
+
+    // binds the mesh's textures for 'shader' without drawing, for draws issued elsewhere (e.g. GpuScene)
+    void BindMaterial(Shader &shader)
+    {
+        materialFor(shader).Bind();
+    }
+
+    // frees the mesh's range of the geometry pool; textures are owned by the TextureCache
+    void Release()
+    {
+        GeometryPool::Get().Remove(geometry);
+        geometry = GeometryPool::INVALID_HANDLE;
+        VAO = 0;
+    }
+
+    // the textures resolved against 'shader', built the first time the mesh is drawn with it
+    const Material &materialFor(const Shader &shader)
+    {
+        for (unsigned int i = 0; i < materials.size(); i++)
+            if (materials[i].program == shader.ID)
+                return materials[i];
+        materials.push_back(Material(textures, shader));
+        return materials.back();
+    }
+
+    // quantizes vertices into the VERTEX_FORMAT_COMPRESSED streams; 'skin' stays empty unless some vertex has bone weights
+    static void Pack(const vector<Vertex> &vertices, vector<PackedVertex> &packed, vector<SkinVertex> &skin)
+    {
+        packed.resize(vertices.size());
+        bool skinned = false;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            const Vertex &v = vertices[i];
+            packed[i].Position = v.Position;
+            glm::vec3 normal = glm::length(v.Normal) > 0.0f ? glm::normalize(v.Normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+            glm::vec3 tangent = glm::length(v.Tangent) > 0.0f ? glm::normalize(v.Tangent) : glm::vec3(1.0f, 0.0f, 0.0f);
+            float handedness = glm::dot(glm::cross(normal, tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+            packed[i].Normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+            packed[i].Tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+            packed[i].TexCoords = glm::packHalf2x16(v.TexCoords);
+            for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+                skinned = skinned || (v.m_BoneIDs[j] >= 0 && v.m_Weights[j] > 0.0f);
+        }
+
+        skin.clear();
+        if (!skinned)
+            return;
+        skin.resize(vertices.size());
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+            {
+                bool used = vertices[i].m_BoneIDs[j] >= 0 && vertices[i].m_Weights[j] > 0.0f;
+                if (used && vertices[i].m_BoneIDs[j] > 255)
+                    cout << "ERROR::MESH::BONE_INDEX_OUT_OF_RANGE: " << vertices[i].m_BoneIDs[j] << endl;
+                skin[i].BoneIDs[j] = used ? static_cast<unsigned char>(vertices[i].m_BoneIDs[j]) : 0;
+                skin[i].Weights[j] = used ? static_cast<unsigned char>(glm::clamp(vertices[i].m_Weights[j], 0.0f, 1.0f) * 255.0f + 0.5f) : 0;
+            }
+        }
     }
 
 private:
-    // render data 
-    unsigned int VBO, EBO;
+    // binding tables, one per shader the mesh was drawn with
+    vector<Material> materials;
 
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        MeshBuffers buffers;
+        buffers.vertexCount = static_cast<unsigned int>(vertices.size());
+        buffers.indices = indices.data();
+        buffers.indexCount = indexCount;
+        buffers.skin = NULL;
+        if (format != VERTEX_FORMAT_COMPRESSED)
+        {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            buffers.vertices = vertices.data();
+            upload(buffers);
+            return;
+        }
 
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        vector<PackedVertex> packed;
+        vector<SkinVertex> skin;
+        Pack(vertices, packed, skin);
+        buffers.vertices = packed.data();
+        buffers.skin = skin.empty() ? NULL : skin.data();
+        upload(buffers);
+    }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    // copies data in the layout of 'format' into the geometry pool
+    void upload(const MeshBuffers &buffers)
+    {
+        // both vertex layouts start with the position
+        GLsizei stride = format == VERTEX_FORMAT_COMPRESSED ? (GLsizei)sizeof(PackedVertex) : (GLsizei)sizeof(Vertex);
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        for (unsigned int i = 0; i < buffers.vertexCount; i++)
+        {
+            const glm::vec3 &position = *(const glm::vec3 *)((const char *)buffers.vertices + (size_t)i * stride);
+            boundsMin = i == 0 ? position : glm::min(boundsMin, position);
+            boundsMax = i == 0 ? position : glm::max(boundsMax, position);
+        }
 
-        // set the vertex attribute pointers
+        geometry = GeometryPool::Get().Add(layoutFor(format, buffers.skin != NULL), buffers);
+        if (geometry == GeometryPool::INVALID_HANDLE)
+        {
+            VAO = 0;
+            indexType = GL_UNSIGNED_INT;
+            return;
+        }
+        // the CPU side always keeps 32 bit indices; the pool narrows the GPU copy when the vertices allow it
+        VAO = GeometryPool::Get().VertexArray(geometry);
+        indexType = GeometryPool::Get().Range(geometry).indexType;
+    }
+
+    // the pool arena of each format: full, compressed, compressed with a bone stream
+    static GeometryLayout layoutFor(VertexFormat format, bool skinned)
+    {
+        if (format != VERTEX_FORMAT_COMPRESSED)
+        {
+            GeometryLayout layout = { 0, sizeof(Vertex), 0, setupFullAttributes };
+            return layout;
+        }
+        GeometryLayout layout = { skinned ? 2u : 1u, sizeof(PackedVertex), skinned ? (GLsizei)sizeof(SkinVertex) : 0, setupCompressedAttributes };
+        return layout;
+    }
+
+    // set the vertex attribute pointers of VERTEX_FORMAT_FULL on the bound vertex array
+    static void setupFullAttributes(GLuint vertexBuffer, GLuint /*skinBuffer*/)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
         // vertex Positions
         glEnableVertexAttribArray(0);	
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -140,7 +321,33 @@ private:
 		// weights
 		glEnableVertexAttribArray(6);
 		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+    }
+
+    // the same for VERTEX_FORMAT_COMPRESSED; the bone stream only exists in the skinned arena
+    static void setupCompressedAttributes(GLuint vertexBuffer, GLuint skinBuffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        // vertex tangent + bitangent sign
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+        if (!skinBuffer)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, skinBuffer);
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, BoneIDs));
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, Weights));
     }
 };
 #endif
@@ -0,0 +1,366 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/material.h>
+#include <learnopengl/mesh.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// On disk layout of a cooked model, all little endian and 16 byte aligned where it matters:
+//   MeshCacheHeader
+//   MeshCacheMesh[meshCount]       in the order Model builds its meshes (depth first over the nodes)
+//   MeshCacheTexture[textureCount] texture references of all meshes
+//   MeshCacheNode[nodeCount]       node hierarchy, parents before their children
+//   strings                        NUL terminated, referenced by offset
+//   data                           vertex, skin and index blobs in the GPU layout of the header's VertexFormat
+// The header records what the data was built from (source size and time, Assimp flags, vertex
+// format); if any of it changed the cache is stale and the model is imported again. The version also
+// changes whenever the import's own processing does (2: meshes are welded and reordered, see mesh_optimizer.h).
+const uint32_t MESH_CACHE_VERSION = 2;
+
+struct MeshCacheHeader {
+    char magic[4]; // "MSHC"
+    uint32_t version;
+    uint32_t vertexFormat;
+    uint32_t importFlags;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t fileSize;
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t nodeCount;
+    uint32_t stringSize;
+    uint64_t strings; // offset of the string block
+};
+
+struct MeshCacheMesh {
+    uint64_t vertices; // offsets into the file
+    uint64_t skin;     // 0 without a skin stream
+    uint64_t indices;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+};
+
+struct MeshCacheTexture {
+    uint32_t type; // string offsets
+    uint32_t path;
+};
+
+struct MeshCacheNode {
+    float transform[16]; // relative to the parent, column major
+    int32_t parent;      // -1 for the root
+    uint32_t name;
+    uint32_t firstMesh;
+    uint32_t meshCount;
+};
+
+class MeshCache {
+public:
+    // the cooked file that belongs to a model: the model's path with .meshcache appended, so
+    // model.fbx and model.gltf don't share one
+    static std::string CachePath(const std::string &source)
+    {
+        return source + ".meshcache";
+    }
+
+    // size and modification time of a file, false if it doesn't exist
+    static bool Stamp(const std::string &path, uint64_t &size, int64_t &time)
+    {
+#ifdef _WIN32
+        struct _stat64 info;
+        if (_stat64(path.c_str(), &info) != 0)
+            return false;
+#else
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return false;
+#endif
+        size = (uint64_t)info.st_size;
+        time = (int64_t)info.st_mtime;
+        return true;
+    }
+};
+
+// Collects the meshes, textures and nodes of an import and writes them as a mesh cache.
+class MeshCacheWriter {
+public:
+    MeshCacheWriter(VertexFormat format) : format(format)
+    {
+        // offset 0 is the empty string
+        strings.push_back('\0');
+    }
+
+    // adds a node whose meshes are the ones added next; returns its index for the children
+    int AddNode(const std::string &name, int parent, const glm::mat4 &transform)
+    {
+        MeshCacheNode node;
+        std::memcpy(node.transform, glm::value_ptr(transform), sizeof(node.transform));
+        node.parent = parent;
+        node.name = addString(name);
+        node.firstMesh = static_cast<uint32_t>(meshes.size());
+        node.meshCount = 0;
+        nodes.push_back(node);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    // adds a mesh of the last node; 'buffers' must be in the writer's vertex format
+    void AddMesh(const MeshBuffers &buffers, const vector<Texture> &meshTextures)
+    {
+        MeshCacheMesh mesh;
+        mesh.vertexCount = buffers.vertexCount;
+        mesh.indexCount = buffers.indexCount;
+        size_t stride = format == VERTEX_FORMAT_COMPRESSED ? sizeof(PackedVertex) : sizeof(Vertex);
+        mesh.vertices = addData(buffers.vertices, buffers.vertexCount * stride);
+        mesh.skin = buffers.skin ? addData(buffers.skin, buffers.vertexCount * sizeof(SkinVertex)) : 0;
+        mesh.indices = addData(buffers.indices, buffers.indexCount * sizeof(unsigned int));
+
+        mesh.firstTexture = static_cast<uint32_t>(textures.size());
+        mesh.textureCount = static_cast<uint32_t>(meshTextures.size());
+        for (unsigned int i = 0; i < meshTextures.size(); i++)
+        {
+            MeshCacheTexture texture;
+            texture.type = addString(meshTextures[i].type);
+            texture.path = addString(meshTextures[i].path);
+            textures.push_back(texture);
+        }
+        meshes.push_back(mesh);
+        if (!nodes.empty())
+            nodes.back().meshCount++;
+    }
+
+    // writes the cache for 'source', which was imported with 'importFlags'
+    bool Save(const std::string &path, const std::string &source, unsigned int importFlags)
+    {
+        MeshCacheHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "MSHC", 4);
+        header.version = MESH_CACHE_VERSION;
+        header.vertexFormat = format;
+        header.importFlags = importFlags;
+        MeshCache::Stamp(source, header.sourceSize, header.sourceTime);
+        header.meshCount = static_cast<uint32_t>(meshes.size());
+        header.textureCount = static_cast<uint32_t>(textures.size());
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+        header.stringSize = static_cast<uint32_t>(strings.size());
+        header.strings = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheMesh) + textures.size() * sizeof(MeshCacheTexture)
+                       + nodes.size() * sizeof(MeshCacheNode);
+        uint64_t dataStart = align(header.strings + strings.size());
+        header.fileSize = dataStart + data.size();
+
+        // blob offsets were relative to the data block so far
+        vector<MeshCacheMesh> placed(meshes);
+        for (unsigned int i = 0; i < placed.size(); i++)
+        {
+            placed[i].vertices += dataStart;
+            placed[i].indices += dataStart;
+            if (placed[i].skin)
+                placed[i].skin += dataStart;
+        }
+
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::MESH_CACHE::FILE_NOT_WRITTEN: " << path << std::endl;
+            return false;
+        }
+        const char padding[16] = { 0 };
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)placed.data(), placed.size() * sizeof(MeshCacheMesh));
+        file.write((const char *)textures.data(), textures.size() * sizeof(MeshCacheTexture));
+        file.write((const char *)nodes.data(), nodes.size() * sizeof(MeshCacheNode));
+        file.write(strings.data(), strings.size());
+        file.write(padding, (std::streamsize)(dataStart - header.strings - strings.size()));
+        file.write((const char *)data.data(), data.size());
+        file.close();
+        bool written = !file.fail();
+        if (!written)
+        {
+            std::cout << "ERROR::MESH_CACHE::FILE_NOT_WRITTEN: " << path << std::endl;
+            std::remove(path.c_str());
+        }
+        return written;
+    }
+
+private:
+    VertexFormat format;
+    vector<MeshCacheMesh> meshes;
+    vector<MeshCacheTexture> textures;
+    vector<MeshCacheNode> nodes;
+    vector<char> strings;
+    vector<unsigned char> data;
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+
+    uint32_t addString(const std::string &value)
+    {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), value.begin(), value.end());
+        strings.push_back('\0');
+        return offset;
+    }
+
+    // returns the offset of the blob within the data block
+    uint64_t addData(const void *bytes, size_t size)
+    {
+        uint64_t offset = align(data.size());
+        data.resize((size_t)offset + size);
+        if (size > 0)
+            std::memcpy(&data[(size_t)offset], bytes, size);
+        return offset;
+    }
+};
+
+// A mapped mesh cache. Open() checks that it is complete and current; everything it hands out
+// points into the mapping and stays valid until the reader is closed or destroyed.
+class MeshCacheReader {
+public:
+    MeshCacheReader() : header(NULL)
+    {
+    }
+
+    // false if the cache is missing, damaged or stale. A cache whose source is gone is still used,
+    // so cooked models can ship without their sources.
+    bool Open(const std::string &path, const std::string &source, VertexFormat format, unsigned int importFlags)
+    {
+        Close();
+        if (!file.Open(path) || file.Size() < sizeof(MeshCacheHeader))
+            return false;
+        const MeshCacheHeader *candidate = (const MeshCacheHeader *)file.Data();
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        bool current = std::memcmp(candidate->magic, "MSHC", 4) == 0 && candidate->version == MESH_CACHE_VERSION
+            && candidate->vertexFormat == (uint32_t)format && candidate->importFlags == importFlags && candidate->fileSize == file.Size();
+        if (current && MeshCache::Stamp(source, sourceSize, sourceTime))
+            current = sourceSize == candidate->sourceSize && sourceTime == candidate->sourceTime;
+        header = candidate;
+        if (!current || !valid())
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        file.Close();
+        header = NULL;
+    }
+
+    unsigned int MeshCount() const
+    {
+        return header->meshCount;
+    }
+
+    const MeshCacheMesh &Mesh(unsigned int index) const
+    {
+        return meshes()[index];
+    }
+
+    unsigned int NodeCount() const
+    {
+        return header->nodeCount;
+    }
+
+    const MeshCacheNode &Node(unsigned int index) const
+    {
+        return nodes()[index];
+    }
+
+    const MeshCacheTexture &Texture(unsigned int index) const
+    {
+        return textures()[index];
+    }
+
+    const char *String(uint32_t offset) const
+    {
+        return (const char *)file.Data() + header->strings + offset;
+    }
+
+    // the mesh's data, ready for Mesh(const MeshBuffers &, ...)
+    MeshBuffers Buffers(const MeshCacheMesh &mesh) const
+    {
+        MeshBuffers buffers;
+        buffers.vertices = file.Data() + mesh.vertices;
+        buffers.vertexCount = mesh.vertexCount;
+        buffers.skin = mesh.skin ? (const SkinVertex *)(file.Data() + mesh.skin) : NULL;
+        buffers.indices = (const unsigned int *)(file.Data() + mesh.indices);
+        buffers.indexCount = mesh.indexCount;
+        return buffers;
+    }
+
+private:
+    MappedFile file;
+    const MeshCacheHeader *header;
+
+    const MeshCacheMesh *meshes() const
+    {
+        return (const MeshCacheMesh *)(file.Data() + sizeof(MeshCacheHeader));
+    }
+
+    const MeshCacheTexture *textures() const
+    {
+        return (const MeshCacheTexture *)(meshes() + header->meshCount);
+    }
+
+    const MeshCacheNode *nodes() const
+    {
+        return (const MeshCacheNode *)(textures() + header->textureCount);
+    }
+
+    bool inside(uint64_t offset, uint64_t size) const
+    {
+        return offset <= file.Size() && size <= file.Size() - offset;
+    }
+
+    // every table, string and blob has to lie inside the file
+    bool valid() const
+    {
+        uint64_t tables = sizeof(MeshCacheHeader) + (uint64_t)header->meshCount * sizeof(MeshCacheMesh)
+                        + (uint64_t)header->textureCount * sizeof(MeshCacheTexture) + (uint64_t)header->nodeCount * sizeof(MeshCacheNode);
+        if (header->strings != tables || header->stringSize == 0 || !inside(header->strings, header->stringSize)
+            || String(header->stringSize - 1)[0] != '\0')
+            return false;
+        uint64_t stride = header->vertexFormat == VERTEX_FORMAT_COMPRESSED ? sizeof(PackedVertex) : sizeof(Vertex);
+        for (unsigned int i = 0; i < header->meshCount; i++)
+        {
+            const MeshCacheMesh &mesh = meshes()[i];
+            if (!inside(mesh.vertices, mesh.vertexCount * stride) || !inside(mesh.indices, mesh.indexCount * (uint64_t)sizeof(unsigned int))
+                || (mesh.skin && !inside(mesh.skin, mesh.vertexCount * (uint64_t)sizeof(SkinVertex)))
+                || (uint64_t)mesh.firstTexture + mesh.textureCount > header->textureCount)
+                return false;
+            // indices past the vertices would read outside the vertex buffer on the GPU
+            const unsigned int *indices = (const unsigned int *)(file.Data() + mesh.indices);
+            for (unsigned int j = 0; j < mesh.indexCount; j++)
+                if (indices[j] >= mesh.vertexCount)
+                    return false;
+        }
+        for (unsigned int i = 0; i < header->textureCount; i++)
+            if (textures()[i].type >= header->stringSize || textures()[i].path >= header->stringSize)
+                return false;
+        for (unsigned int i = 0; i < header->nodeCount; i++)
+        {
+            const MeshCacheNode &node = nodes()[i];
+            if (node.parent >= (int32_t)i || node.name >= header->stringSize || (uint64_t)node.firstMesh + node.meshCount > header->meshCount)
+                return false;
+        }
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,392 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// what Optimize did to a mesh; ACMR is the average number of vertex shader runs per triangle
+// with a FIFO post-transform cache of MeshOptimizer::CACHE_SIZE entries (0.5 is the best possible
+// on a large regular grid, 3 means no reuse at all)
+struct MeshOptimizationStats {
+    unsigned int triangles;
+    unsigned int verticesBefore;
+    unsigned int verticesAfter;
+    float acmrBefore;
+    float acmrAfter;
+
+    MeshOptimizationStats() : triangles(0), verticesBefore(0), verticesAfter(0), acmrBefore(0.0f), acmrAfter(0.0f)
+    {
+    }
+
+    // adds the stats of another mesh, ACMR weighted by triangles
+    void Add(const MeshOptimizationStats &other)
+    {
+        unsigned int total = triangles + other.triangles;
+        if (total > 0)
+        {
+            acmrBefore = (acmrBefore * triangles + other.acmrBefore * other.triangles) / total;
+            acmrAfter = (acmrAfter * triangles + other.acmrAfter * other.triangles) / total;
+        }
+        triangles = total;
+        verticesBefore += other.verticesBefore;
+        verticesAfter += other.verticesAfter;
+    }
+};
+
+// Reorders imported triangle lists for the GPU, after "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw" (Sander, Nehab, Barczak 2007):
+//   1. Weld merges vertices whose imported attributes are identical, so neighbouring triangles share them
+//   2. OptimizeVertexCache (Tipsify) orders triangles so their vertices are still in the post-transform cache
+//   3. OptimizeOverdraw splits that order into clusters and draws the outward facing ones first
+//   4. OptimizeVertexFetch numbers the vertices in the order they're first used, so fetches walk memory forward
+// Everything is CPU only and works on one mesh, so meshes can be optimized on worker threads.
+class MeshOptimizer {
+public:
+    static const unsigned int CACHE_SIZE = 16;
+
+    // runs all steps; tangents are expected to be computed afterwards (they aren't compared when welding)
+    static MeshOptimizationStats Optimize(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        MeshOptimizationStats stats;
+        stats.triangles = static_cast<unsigned int>(indices.size() / 3);
+        stats.verticesBefore = static_cast<unsigned int>(vertices.size());
+        stats.acmrBefore = ACMR(indices, vertices.size());
+        Weld(vertices, indices);
+        // point and line faces survive aiProcess_Triangulate; such meshes keep their order
+        if (indices.size() % 3 == 0)
+        {
+            vector<unsigned int> clusters = OptimizeVertexCache(indices, vertices.size());
+            OptimizeOverdraw(indices, vertices, clusters);
+            OptimizeVertexFetch(vertices, indices);
+        }
+        stats.verticesAfter = static_cast<unsigned int>(vertices.size());
+        stats.acmrAfter = ACMR(indices, vertices.size());
+        return stats;
+    }
+
+    // vertex shader runs per triangle with a FIFO cache of 'cacheSize' entries
+    static float ACMR(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        if (indices.size() < 3)
+            return 0.0f;
+        // a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+        vector<unsigned int> loaded(vertexCount, 0);
+        unsigned int misses = 0;
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int v = indices[i];
+            if (loaded[v] == 0 || misses - loaded[v] >= cacheSize)
+                loaded[v] = ++misses;
+        }
+        return (float)misses / (indices.size() / 3);
+    }
+
+    // merges vertices with bitwise identical position, normal, uv and bone data (hash based, keeps the
+    // first occurrence) and rewrites the indices
+    static void Weld(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        std::unordered_map<WeldKey, unsigned int, WeldKeyHash> unique;
+        unique.reserve(vertices.size());
+        vector<unsigned int> remap(vertices.size());
+        unsigned int count = 0;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            std::pair<std::unordered_map<WeldKey, unsigned int, WeldKeyHash>::iterator, bool> inserted = unique.insert(std::make_pair(WeldKey(vertices[i]), count));
+            if (inserted.second)
+            {
+                if (count != i)
+                    vertices[count] = vertices[i];
+                count++;
+            }
+            remap[i] = inserted.first->second;
+        }
+        vertices.resize(count);
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = remap[indices[i]];
+    }
+
+    // Tipsify: fans around one vertex at a time and continues with the neighbour that is most likely
+    // still cached. Returns the first triangle of every cluster, i.e. every point where it had to jump
+    // to an unconnected part of the mesh and the cache starts cold.
+    static vector<unsigned int> OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        size_t triangleCount = indices.size() / 3;
+        vector<unsigned int> clusters;
+        if (triangleCount == 0 || vertexCount == 0)
+            return clusters;
+
+        // vertex -> triangles using it, as offsets into one array
+        vector<unsigned int> live(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            live[indices[i]]++;
+        vector<unsigned int> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + live[v];
+        vector<unsigned int> adjacency(offsets[vertexCount]);
+        vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+        vector<unsigned int> timestamps(vertexCount, 0);
+        vector<unsigned int> deadEnds;
+        vector<bool> emitted(triangleCount, false);
+        vector<unsigned int> candidates;
+        vector<unsigned int> result;
+        result.reserve(triangleCount * 3);
+        unsigned int time = cacheSize + 1;
+        size_t cursor = 0;
+        int fanning = 0;
+        clusters.push_back(0);
+        while (fanning >= 0)
+        {
+            candidates.clear();
+            for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++)
+            {
+                unsigned int triangle = adjacency[a];
+                if (emitted[triangle])
+                    continue;
+                for (int c = 0; c < 3; c++)
+                {
+                    unsigned int v = indices[triangle * 3 + c];
+                    result.push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - timestamps[v] > cacheSize)
+                        timestamps[v] = time++;
+                }
+                emitted[triangle] = true;
+            }
+
+            // the candidate that will still be cached after emitting its remaining triangles, and
+            // of those the one that entered the cache first
+            int next = -1;
+            unsigned int best = 0;
+            for (size_t c = 0; c < candidates.size(); c++)
+            {
+                unsigned int v = candidates[c];
+                if (live[v] == 0)
+                    continue;
+                unsigned int priority = 0;
+                if (time - timestamps[v] + 2 * live[v] <= cacheSize)
+                    priority = time - timestamps[v];
+                if (priority > best || next < 0)
+                {
+                    best = priority;
+                    next = static_cast<int>(v);
+                }
+            }
+            if (next < 0)
+            {
+                next = skipDeadEnd(live, deadEnds, cursor);
+                if (next >= 0 && result.size() / 3 != clusters.back())
+                    clusters.push_back(static_cast<unsigned int>(result.size() / 3));
+            }
+            fanning = next;
+        }
+        indices.swap(result);
+        return clusters;
+    }
+
+    // splits the clusters further wherever the cache has warmed up again ('threshold' times the cluster's
+    // ACMR), then sorts them so clusters facing away from the mesh centre, which tend to occlude the
+    // rest, are drawn first. 'clusters' holds the first triangle of every cluster, as OptimizeVertexCache returns.
+    static void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, const vector<unsigned int> &clusters, float threshold = 1.05f)
+    {
+        unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+        if (triangleCount == 0 || clusters.empty())
+            return;
+        vector<unsigned int> boundaries = splitClusters(indices, vertices.size(), clusters, threshold);
+        if (boundaries.size() < 2)
+            return;
+
+        // area weighted centre of the whole mesh
+        glm::vec3 meshCentre(0.0f);
+        float meshArea = 0.0f;
+        for (unsigned int t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 normal = faceNormal(indices, vertices, t);
+            float area = glm::length(normal);
+            meshCentre += triangleCentre(indices, vertices, t) * area;
+            meshArea += area;
+        }
+        if (meshArea > 0.0f)
+            meshCentre /= meshArea;
+
+        struct Cluster {
+            unsigned int first;
+            unsigned int count;
+            float key;
+        };
+        vector<Cluster> sorted(boundaries.size());
+        for (unsigned int c = 0; c < boundaries.size(); c++)
+        {
+            Cluster &cluster = sorted[c];
+            cluster.first = boundaries[c];
+            cluster.count = (c + 1 < boundaries.size() ? boundaries[c + 1] : triangleCount) - cluster.first;
+            glm::vec3 centre(0.0f), normal(0.0f);
+            float area = 0.0f;
+            for (unsigned int t = cluster.first; t < cluster.first + cluster.count; t++)
+            {
+                glm::vec3 face = faceNormal(indices, vertices, t);
+                float faceArea = glm::length(face);
+                centre += triangleCentre(indices, vertices, t) * faceArea;
+                normal += face;
+                area += faceArea;
+            }
+            if (area > 0.0f)
+                centre /= area;
+            float length = glm::length(normal);
+            cluster.key = length > 0.0f ? glm::dot(centre - meshCentre, normal / length) : 0.0f;
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+        vector<unsigned int> result;
+        result.reserve(indices.size());
+        for (unsigned int c = 0; c < sorted.size(); c++)
+            result.insert(result.end(), indices.begin() + sorted[c].first * 3, indices.begin() + (sorted[c].first + sorted[c].count) * 3);
+        indices.swap(result);
+    }
+
+    // renumbers the vertices in the order the indices first use them; unused vertices are dropped
+    static void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        const unsigned int unused = ~0u;
+        vector<unsigned int> remap(vertices.size(), unused);
+        vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            unsigned int &target = remap[indices[i]];
+            if (target == unused)
+            {
+                target = static_cast<unsigned int>(ordered.size());
+                ordered.push_back(vertices[indices[i]]);
+            }
+            indices[i] = target;
+        }
+        vertices.swap(ordered);
+    }
+
+private:
+    // the attributes that come from the source file; tangents are derived later
+    struct WeldKey {
+        float data[3 + 3 + 2 + MAX_BONE_INFLUENCE];
+        int bones[MAX_BONE_INFLUENCE];
+
+        explicit WeldKey(const Vertex &vertex)
+        {
+            std::memcpy(data, &vertex.Position[0], sizeof(float) * 3);
+            std::memcpy(data + 3, &vertex.Normal[0], sizeof(float) * 3);
+            std::memcpy(data + 6, &vertex.TexCoords[0], sizeof(float) * 2);
+            std::memcpy(data + 8, vertex.m_Weights, sizeof(vertex.m_Weights));
+            std::memcpy(bones, vertex.m_BoneIDs, sizeof(bones));
+        }
+
+        bool operator==(const WeldKey &other) const
+        {
+            return std::memcmp(data, other.data, sizeof(data)) == 0 && std::memcmp(bones, other.bones, sizeof(bones)) == 0;
+        }
+    };
+
+    struct WeldKeyHash {
+        size_t operator()(const WeldKey &key) const
+        {
+            // FNV-1a over the bytes
+            const unsigned char *bytes = (const unsigned char *)&key;
+            size_t hash = (size_t)14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(WeldKey); i++)
+                hash = (hash ^ bytes[i]) * (size_t)1099511628211ull;
+            return hash;
+        }
+    };
+
+    // the most recent dead end vertex that still has triangles left, else the next one in index order
+    static int skipDeadEnd(const vector<unsigned int> &live, vector<unsigned int> &deadEnds, size_t &cursor)
+    {
+        while (!deadEnds.empty())
+        {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[v] > 0)
+                return static_cast<int>(v);
+        }
+        for (; cursor < live.size(); cursor++)
+            if (live[cursor] > 0)
+                return static_cast<int>(cursor);
+        return -1;
+    }
+
+    // cluster starts after adding soft boundaries: a cluster is cut once its cache simulation (from a
+    // cold cache) is back within 'threshold' of the whole cluster's ACMR, so drawing the parts in another
+    // order costs little vertex reuse. The simulations share one miss clock that is never reset: a
+    // simulation starting at 'base' treats every vertex loaded at or before it as not cached, so a
+    // cold start costs nothing instead of clearing the flag of every vertex.
+    static vector<unsigned int> splitClusters(const vector<unsigned int> &indices, size_t vertexCount, const vector<unsigned int> &clusters, float threshold)
+    {
+        const unsigned int minimumTriangles = 64;
+        unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+        vector<unsigned int> boundaries;
+        vector<unsigned int> loaded(vertexCount, 0);
+        unsigned int clock = 0;
+        for (unsigned int c = 0; c < clusters.size(); c++)
+        {
+            unsigned int first = clusters[c];
+            unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            boundaries.push_back(first);
+            float limit = threshold * clusterACMR(indices, first, end, loaded, clock);
+
+            unsigned int base = clock, start = first;
+            for (unsigned int t = first; t < end; t++)
+            {
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int v = indices[t * 3 + corner];
+                    if (loaded[v] <= base || clock - loaded[v] >= CACHE_SIZE)
+                        loaded[v] = ++clock;
+                }
+                unsigned int count = t + 1 - start;
+                if (count >= minimumTriangles && t + 1 < end && (float)(clock - base) / count <= limit)
+                {
+                    boundaries.push_back(t + 1);
+                    start = t + 1;
+                    base = clock;
+                }
+            }
+        }
+        return boundaries;
+    }
+
+    // ACMR of triangles first .. end - 1 from a cold cache, on the shared clock of splitClusters
+    static float clusterACMR(const vector<unsigned int> &indices, unsigned int first, unsigned int end, vector<unsigned int> &loaded, unsigned int &clock)
+    {
+        unsigned int base = clock;
+        for (unsigned int i = first * 3; i < end * 3; i++)
+        {
+            unsigned int v = indices[i];
+            if (loaded[v] <= base || clock - loaded[v] >= CACHE_SIZE)
+                loaded[v] = ++clock;
+        }
+        return end > first ? (float)(clock - base) / (end - first) : 0.0f;
+    }
+
+    // unnormalized, its length is twice the triangle's area
+    static glm::vec3 faceNormal(const vector<unsigned int> &indices, const vector<Vertex> &vertices, unsigned int triangle)
+    {
+        const glm::vec3 &a = vertices[indices[triangle * 3]].Position;
+        return glm::cross(vertices[indices[triangle * 3 + 1]].Position - a, vertices[indices[triangle * 3 + 2]].Position - a);
+    }
+
+    static glm::vec3 triangleCentre(const vector<unsigned int> &indices, const vector<Vertex> &vertices, unsigned int triangle)
+    {
+        return (vertices[indices[triangle * 3]].Position + vertices[indices[triangle * 3 + 1]].Position + vertices[indices[triangle * 3 + 2]].Position) / 3.0f;
+    }
+};
+#endif
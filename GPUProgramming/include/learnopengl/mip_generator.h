@@ -0,0 +1,309 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX__) || defined(__AVX2__)
+#include <immintrin.h>
+#define MIP_GENERATOR_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+enum MipFilter {
+    MIP_FILTER_BOX,   // 2x2 average, what glGenerateMipmap does on most drivers
+    MIP_FILTER_KAISER // Kaiser windowed sinc over 3 texels each side, keeps lower levels sharper
+};
+
+// one level of a mip chain, tightly packed with the components of the source image
+struct MipLevel {
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+// Builds mip chains on the CPU so it can happen on a worker thread at load time and gives the
+// same result on every driver. Filtering runs in linear float: sRGB images are linearized first,
+// and with alpha weighting the colour is premultiplied by alpha, so transparent texels don't bleed
+// their (meaningless) colour into the edges of lower levels. Every level is filtered from the float
+// copy of the previous one, not from its 8 bit rounding. The filters are separable; both passes
+// work on 4 floats per texel, which maps to SSE2 per texel and AVX for two at a time.
+class MipGenerator {
+public:
+    // number of levels of a full chain down to 1x1, including level 0
+    static unsigned int LevelCount(int width, int height)
+    {
+        unsigned int levels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2)
+            levels++;
+        return levels;
+    }
+
+    // bytes of the whole chain including level 0, levels packed back to back
+    static size_t ChainSize(int width, int height, int components)
+    {
+        size_t size = 0;
+        for (unsigned int level = 0; level < LevelCount(width, height); level++)
+            size += (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * components;
+        return size;
+    }
+
+    // returns levels 1 .. LevelCount - 1 of an 8 bit image with 1-4 components. 'srgb' only applies
+    // to colour channels, alpha is always linear. 'alphaWeighted' is ignored for images without alpha.
+    static std::vector<MipLevel> Generate(const unsigned char *data, int width, int height, int components,
+        MipFilter filter = MIP_FILTER_KAISER, bool srgb = false, bool alphaWeighted = true)
+    {
+        std::vector<MipLevel> levels;
+        generate(data, width, height, components, filter, srgb, alphaWeighted, NULL, &levels);
+        return levels;
+    }
+
+    // writes the whole chain, level 0 included, back to back into 'destination' (ChainSize bytes),
+    // e.g. a mapped pixel unpack buffer. The destination is only written to.
+    static void GenerateInto(const unsigned char *data, int width, int height, int components, unsigned char *destination,
+        MipFilter filter = MIP_FILTER_KAISER, bool srgb = false, bool alphaWeighted = true)
+    {
+        std::memcpy(destination, data, (size_t)width * height * components);
+        generate(data, width, height, components, filter, srgb, alphaWeighted, destination + (size_t)width * height * components, NULL);
+    }
+
+private:
+    static void generate(const unsigned char *data, int width, int height, int components, MipFilter filter, bool srgb, bool alphaWeighted,
+        unsigned char *destination, std::vector<MipLevel> *levels)
+    {
+        int alpha = (components == 2 || components == 4) ? components - 1 : -1;
+        int colours = alpha >= 0 ? components - 1 : components;
+        if (!alphaWeighted)
+            alpha = -1;
+
+        std::vector<float> level((size_t)width * height * 4);
+        const float *toLinear = srgbTables().toLinear;
+        for (size_t i = 0; i < (size_t)width * height; i++)
+        {
+            float *texel = &level[i * 4];
+            texel[0] = texel[1] = texel[2] = texel[3] = 0.0f;
+            for (int c = 0; c < components; c++)
+                texel[c] = srgb && c < colours ? toLinear[data[i * components + c]] : data[i * components + c] / 255.0f;
+            if (alpha >= 0)
+                for (int c = 0; c < colours; c++)
+                    texel[c] *= texel[alpha];
+        }
+
+        std::vector<float> next;
+        while (width > 1 || height > 1)
+        {
+            int newWidth = std::max(width / 2, 1);
+            int newHeight = std::max(height / 2, 1);
+            downsample(level, width, height, next, newWidth, newHeight, filter);
+            level.swap(next);
+            width = newWidth;
+            height = newHeight;
+
+            size_t size = (size_t)width * height * components;
+            if (destination)
+            {
+                toBytes(level, destination, size, components, colours, alpha, srgb);
+                destination += size;
+                continue;
+            }
+            MipLevel mip;
+            mip.width = width;
+            mip.height = height;
+            mip.pixels.resize(size);
+            toBytes(level, mip.pixels.data(), size, components, colours, alpha, srgb);
+            levels->push_back(std::move(mip));
+        }
+    }
+
+    static const int MAX_TAPS = 12;
+    // kernel radius in destination texels and the Kaiser window's shape parameter
+    static constexpr float KAISER_RADIUS = 1.5f;
+    static constexpr float KAISER_BETA = 4.0f;
+
+    // the source texels (clamped to the edge) and weights that make up one destination texel along an axis
+    struct FilterTaps {
+        int count;
+        int index[MAX_TAPS];
+        float weight[MAX_TAPS];
+    };
+
+    static std::vector<FilterTaps> buildTaps(int size, int newSize, MipFilter filter)
+    {
+        std::vector<FilterTaps> taps(newSize);
+        float scale = (float)size / newSize;
+        for (int x = 0; x < newSize; x++)
+        {
+            FilterTaps &tap = taps[x];
+            tap.count = 0;
+            if (filter == MIP_FILTER_BOX || size == newSize)
+            {
+                // texels 2x and 2x + 1; an odd last texel is dropped just like GL sizes the level
+                int first = size == newSize ? x : 2 * x;
+                int last = size == newSize ? x : std::min(2 * x + 1, size - 1);
+                for (int s = first; s <= last; s++)
+                {
+                    tap.index[tap.count] = s;
+                    tap.weight[tap.count++] = 1.0f / (last - first + 1);
+                }
+                continue;
+            }
+
+            float center = (x + 0.5f) * scale - 0.5f;
+            float support = KAISER_RADIUS * scale;
+            int first = (int)std::ceil(center - support);
+            int last = (int)std::floor(center + support);
+            float sum = 0.0f;
+            for (int s = first; s <= last && tap.count < MAX_TAPS; s++)
+            {
+                float u = (s - center) / scale;
+                float weight = sinc(u) * kaiser(u / KAISER_RADIUS);
+                if (weight == 0.0f)
+                    continue;
+                tap.index[tap.count] = std::min(std::max(s, 0), size - 1);
+                tap.weight[tap.count++] = weight;
+                sum += weight;
+            }
+            for (int i = 0; i < tap.count; i++)
+                tap.weight[i] /= sum;
+        }
+        return taps;
+    }
+
+    static void downsample(const std::vector<float> &source, int width, int height, std::vector<float> &target, int newWidth, int newHeight, MipFilter filter)
+    {
+        std::vector<FilterTaps> columns = buildTaps(width, newWidth, filter);
+        std::vector<FilterTaps> rows = buildTaps(height, newHeight, filter);
+        std::vector<float> row((size_t)width * 4);
+        target.resize((size_t)newWidth * newHeight * 4);
+        for (int y = 0; y < newHeight; y++)
+        {
+            // vertical pass over a whole source row, then the horizontal pass per destination texel
+            const FilterTaps &vertical = rows[y];
+            std::fill(row.begin(), row.end(), 0.0f);
+            for (int i = 0; i < vertical.count; i++)
+                accumulate(row.data(), &source[(size_t)vertical.index[i] * width * 4], vertical.weight[i], row.size());
+            for (int x = 0; x < newWidth; x++)
+                filterTexel(row.data(), columns[x], &target[((size_t)y * newWidth + x) * 4]);
+        }
+    }
+
+    // target += source * weight over 'count' floats
+    static void accumulate(float *target, const float *source, float weight, size_t count)
+    {
+        size_t i = 0;
+#ifdef MIP_GENERATOR_AVX
+        __m256 weight8 = _mm256_set1_ps(weight);
+        for (; i + 8 <= count; i += 8)
+            _mm256_storeu_ps(target + i, _mm256_add_ps(_mm256_loadu_ps(target + i), _mm256_mul_ps(_mm256_loadu_ps(source + i), weight8)));
+#endif
+#ifdef MIP_GENERATOR_SSE2
+        __m128 weight4 = _mm_set1_ps(weight);
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_ps(target + i, _mm_add_ps(_mm_loadu_ps(target + i), _mm_mul_ps(_mm_loadu_ps(source + i), weight4)));
+#endif
+        for (; i < count; i++)
+            target[i] += source[i] * weight;
+    }
+
+    static void filterTexel(const float *row, const FilterTaps &taps, float *texel)
+    {
+#ifdef MIP_GENERATOR_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (int i = 0; i < taps.count; i++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + taps.index[i] * 4), _mm_set1_ps(taps.weight[i])));
+        _mm_storeu_ps(texel, sum);
+#else
+        texel[0] = texel[1] = texel[2] = texel[3] = 0.0f;
+        for (int i = 0; i < taps.count; i++)
+            for (int c = 0; c < 4; c++)
+                texel[c] += row[taps.index[i] * 4 + c] * taps.weight[i];
+#endif
+    }
+
+    // back to 8 bit: undo the alpha weighting, re-encode sRGB and round
+    static void toBytes(const std::vector<float> &level, unsigned char *pixels, size_t size, int components, int colours, int alpha, bool srgb)
+    {
+        const unsigned char *toSrgb = srgbTables().toSrgb;
+        size_t count = size / components;
+        for (size_t i = 0; i < count; i++)
+        {
+            const float *texel = &level[i * 4];
+            // the Kaiser kernel's negative lobes can overshoot
+            float coverage = alpha >= 0 ? std::min(std::max(texel[alpha], 0.0f), 1.0f) : 1.0f;
+            for (int c = 0; c < components; c++)
+            {
+                float value = texel[c];
+                if (c < colours && alpha >= 0)
+                    value = coverage > 0.0f ? value / coverage : 0.0f;
+                value = std::min(std::max(value, 0.0f), 1.0f);
+                if (srgb && c < colours)
+                    pixels[i * components + c] = toSrgb[(int)(value * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+                else
+                    pixels[i * components + c] = (unsigned char)(value * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    static const int SRGB_TABLE_SIZE = 4096;
+
+    // conversion tables, built once (thread safe, workers generate mips concurrently)
+    struct SrgbTables {
+        float toLinear[256];
+        unsigned char toSrgb[SRGB_TABLE_SIZE];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float value = i / 255.0f;
+                toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < SRGB_TABLE_SIZE; i++)
+            {
+                float value = (float)i / (SRGB_TABLE_SIZE - 1);
+                float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                toSrgb[i] = (unsigned char)(encoded * 255.0f + 0.5f);
+            }
+        }
+    };
+
+    static const SrgbTables &srgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    static float sinc(float x)
+    {
+        if (std::fabs(x) < 1e-5f)
+            return 1.0f;
+        const float pi = 3.14159265358979f;
+        return std::sin(pi * x) / (pi * x);
+    }
+
+    // Kaiser window over [-1, 1]
+    static float kaiser(float x)
+    {
+        if (std::fabs(x) >= 1.0f)
+            return 0.0f;
+        return besselI0(KAISER_BETA * std::sqrt(1.0f - x * x)) / besselI0(KAISER_BETA);
+    }
+
+    // modified Bessel function of the first kind, order 0 (power series)
+    static float besselI0(float x)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 20; k++)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    }
+};
+#endif
@@ -5,37 +5,70 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/compressed_texture.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, AsyncTextureLoader *loader = nullptr);
+
+// a node of the model's hierarchy; its meshes are meshes[firstMesh, firstMesh + meshCount)
+struct ModelNode {
+    string name;
+    int parent; // index in Model::nodes, -1 for the root
+    glm::mat4 transform; // relative to the parent
+    unsigned int firstMesh;
+    unsigned int meshCount;
+};
 
 class Model 
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// stores all the textures loaded so far; the model holds one TextureCache reference on each of them.
     vector<Mesh>    meshes;
+    vector<ModelNode> nodes; // parents come before their children
+    MeshOptimizationStats optimization; // of the last import, empty when the model came from its mesh cache
     string directory;
     bool gammaCorrection;
+    VertexFormat vertexFormat;
+    bool releaseCpuData;
+    AsyncTextureLoader *textureLoader;
+
+    // Assimp post processing the meshes go through; part of the mesh cache's key. Tangents are computed
+    // per mesh during the parallel conversion instead of by aiProcess_CalcTangentSpace.
+    static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
 
-    // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // constructor, expects a filepath to a 3D model. VERTEX_FORMAT_COMPRESSED roughly halves vertex memory (see mesh.h),
+    // releaseCpuData drops the meshes' vertex/index arrays after they're uploaded.
+    // with a textureLoader the textures are decoded in the background and show a placeholder until its Update() uploaded them.
+    // with a threadPool the meshes of an import are converted in parallel on it.
+    Model(string const &path, bool gamma = false, VertexFormat format = VERTEX_FORMAT_FULL, bool releaseCpuData = false, AsyncTextureLoader *textureLoader = nullptr,
+        ThreadPool *threadPool = nullptr)
+        : gammaCorrection(gamma), vertexFormat(format), releaseCpuData(releaseCpuData), textureLoader(textureLoader)
     {
-        loadModel(path);
+        loadModel(path, threadPool);
     }
 
     // draws the model, and thus all its meshes
@@ -43,107 +76,285 @@ public:
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
+        GeometryPool::Get().Unbind();
+    }
+
+    // draws 'count' copies of the model, one draw per mesh; transforms[i] places copy i (see Mesh::DrawInstanced).
+    // The transforms are uploaded once and shared by all meshes.
+    void DrawInstanced(Shader &shader, const glm::mat4 *transforms, unsigned int count)
+    {
+        if (count == 0)
+            return;
+        GLintptr instances = InstanceBuffer::Get().Upload(transforms, count);
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, instances, count);
+        GeometryPool::Get().Unbind();
+    }
+
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &transforms)
+    {
+        DrawInstanced(shader, transforms.data(), static_cast<unsigned int>(transforms.size()));
+    }
+
+    // frees the meshes and drops the model's texture references; textures no other model uses are deleted
+    void Release()
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Release();
+        meshes.clear();
+        nodes.clear();
+        for(unsigned int i = 0; i < textures_loaded.size(); i++)
+            TextureCache::Get().Release(TextureCacheKey(TextureCache::Canonical(directory + '/' + textures_loaded[i].path), gammaCorrection));
+        textures_loaded.clear();
+        loadedTextureIndex.clear();
     }
     
 private:
+    // path -> index in textures_loaded
+    unordered_map<string, unsigned int> loadedTextureIndex;
+
+    // one aiMesh of the import and what the workers turn it into
+    struct MeshImport {
+        const aiMesh *mesh;
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        // the VERTEX_FORMAT_COMPRESSED streams, empty for VERTEX_FORMAT_FULL
+        vector<PackedVertex> packed;
+        vector<SkinVertex> skin;
+        MeshOptimizationStats optimization;
+    };
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    // a current mesh cache next to the file (see mesh_cache.h) is mapped and uploaded instead; after an
+    // import the cache is written so the next run skips Assimp.
+    // an import runs in three steps: the node tree is flattened into one job per mesh, the jobs convert,
+    // optimize (mesh_optimizer.h) and pack the vertices on the pool, and the GL thread then loads the textures and uploads the meshes in node order.
+    void loadModel(string const &path, ThreadPool *threadPool)
     {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+        string cachePath = MeshCache::CachePath(path);
+        if (loadCache(cachePath, path))
+            return;
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<MeshImport> imports;
+        imports.reserve(scene->mNumMeshes);
+        processNode(scene->mRootNode, scene, -1, imports);
+
+        // largest meshes first, so a big one doesn't start last and keep a single worker busy at the end
+        vector<unsigned int> order(imports.size());
+        for (unsigned int i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&imports](unsigned int a, unsigned int b) {
+            return imports[a].mesh->mNumVertices > imports[b].mesh->mNumVertices;
+        });
+        VertexFormat format = vertexFormat;
+        auto convert = [&imports, &order, format](int i) { convertMesh(imports[order[i]], format); };
+        if (threadPool)
+            threadPool->ParallelFor(static_cast<int>(imports.size()), convert);
+        else
+            for (unsigned int i = 0; i < imports.size(); i++)
+                convert(static_cast<int>(i));
+
+        for (unsigned int i = 0; i < imports.size(); i++)
+            optimization.Add(imports[i].optimization);
+        cout << "MODEL::OPTIMIZED: " << path << ": ACMR " << optimization.acmrBefore << " -> " << optimization.acmrAfter << ", "
+             << optimization.verticesBefore << " -> " << optimization.verticesAfter << " vertices" << endl;
+
+        MeshCacheWriter cache(vertexFormat);
+        meshes.reserve(imports.size());
+        for (unsigned int i = 0; i < nodes.size(); i++)
+        {
+            cache.AddNode(nodes[i].name, nodes[i].parent, nodes[i].transform);
+            for (unsigned int j = nodes[i].firstMesh; j < nodes[i].firstMesh + nodes[i].meshCount; j++)
+            {
+                MeshImport &import = imports[j];
+                vector<Texture> textures = loadMaterial(scene->mMaterials[import.mesh->mMaterialIndex]);
+                MeshBuffers buffers;
+                buffers.vertices = vertexFormat == VERTEX_FORMAT_COMPRESSED ? (const void *)import.packed.data() : (const void *)import.vertices.data();
+                buffers.vertexCount = static_cast<unsigned int>(import.vertices.size());
+                buffers.skin = import.skin.empty() ? NULL : import.skin.data();
+                buffers.indices = import.indices.data();
+                buffers.indexCount = static_cast<unsigned int>(import.indices.size());
+                cache.AddMesh(buffers, textures);
+                // moving the vectors into the mesh keeps their storage, so 'buffers' stays valid for the upload
+                meshes.push_back(Mesh(std::move(import.vertices), std::move(import.indices), std::move(textures), buffers, vertexFormat, releaseCpuData));
+                vector<PackedVertex>().swap(import.packed);
+                vector<SkinVertex>().swap(import.skin);
+            }
+        }
+        cache.Save(cachePath, path, IMPORT_FLAGS);
+    }
+
+    // builds the meshes and nodes straight from a mapped cache; false if there is no current one
+    bool loadCache(const string &cachePath, const string &path)
+    {
+        MeshCacheReader cache;
+        if (!cache.Open(cachePath, path, vertexFormat, IMPORT_FLAGS))
+            return false;
+        meshes.reserve(cache.MeshCount());
+        for (unsigned int i = 0; i < cache.MeshCount(); i++)
+        {
+            const MeshCacheMesh &mesh = cache.Mesh(i);
+            vector<Texture> textures;
+            for (unsigned int j = 0; j < mesh.textureCount; j++)
+            {
+                const MeshCacheTexture &texture = cache.Texture(mesh.firstTexture + j);
+                textures.push_back(loadTexture(cache.String(texture.path), cache.String(texture.type)));
+            }
+            meshes.push_back(Mesh(cache.Buffers(mesh), std::move(textures), vertexFormat));
+        }
+        nodes.resize(cache.NodeCount());
+        for (unsigned int i = 0; i < cache.NodeCount(); i++)
+        {
+            const MeshCacheNode &node = cache.Node(i);
+            nodes[i].name = cache.String(node.name);
+            nodes[i].parent = node.parent;
+            nodes[i].transform = glm::make_mat4(node.transform);
+            nodes[i].firstMesh = node.firstMesh;
+            nodes[i].meshCount = node.meshCount;
+        }
+        return true;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // walks the node tree depth first, recording the nodes and a job for each of their meshes; the meshes
+    // of a node end up next to each other in 'imports' (and later in meshes).
+    void processNode(const aiNode *node, const aiScene *scene, int parent, vector<MeshImport> &imports)
     {
-        // process each mesh located at the current node
+        // assimp matrices are row major
+        ModelNode modelNode;
+        modelNode.name = node->mName.C_Str();
+        modelNode.parent = parent;
+        modelNode.transform = glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+        modelNode.firstMesh = static_cast<unsigned int>(imports.size());
+        modelNode.meshCount = node->mNumMeshes;
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back(modelNode);
+
+        // the node object only contains indices to index the actual objects in the scene.
+        // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
-            // the node object only contains indices to index the actual objects in the scene. 
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            MeshImport import;
+            import.mesh = scene->mMeshes[node->mMeshes[i]];
+            imports.push_back(std::move(import));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, index, imports);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // converts one aiMesh on a worker: only reads the mesh and writes 'import', no GL and no model state
+    static void convertMesh(MeshImport &import, VertexFormat format)
     {
+        const aiMesh *mesh = import.mesh;
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        vector<Vertex> &vertices = import.vertices;
+        vector<unsigned int> &indices = import.indices;
+        vertices.resize(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3); // faces are triangles after aiProcess_Triangulate
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+            Vertex &vertex = vertices[i];
+            // no bone influences unless an animation loader fills them in
+            for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+            {
+                vertex.m_BoneIDs[j] = -1;
+                vertex.m_Weights[j] = 0.0f;
+            }
+            // assimp uses its own vector class that doesn't directly convert to glm's vec3 class
             // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
+            vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
             // normals
             if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
+                vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            else
+                vertex.Normal = glm::vec3(0.0f);
             // texture coordinates
+            // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+            // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
             if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-            {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x; 
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
+                vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace &face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);        
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
+
+        // welded and reordered before the tangents, so welded vertices average the tangents of all their triangles
+        import.optimization = MeshOptimizer::Optimize(vertices, indices);
+        calculateTangents(vertices, indices);
+        if (format == VERTEX_FORMAT_COMPRESSED)
+            Mesh::Pack(vertices, import.packed, import.skin);
+    }
+
+    // per vertex tangent frames from the uv gradients of the triangles around each vertex, orthogonalized
+    // against the normal. Vertices without a usable uv gradient get some tangent perpendicular to the normal.
+    static void calculateTangents(vector<Vertex> &vertices, const vector<unsigned int> &indices)
+    {
+        vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
+        vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            unsigned int corner[3] = { indices[i], indices[i + 1], indices[i + 2] };
+            if (corner[0] >= vertices.size() || corner[1] >= vertices.size() || corner[2] >= vertices.size())
+                continue;
+            const Vertex &v0 = vertices[corner[0]];
+            glm::vec3 edge1 = vertices[corner[1]].Position - v0.Position;
+            glm::vec3 edge2 = vertices[corner[2]].Position - v0.Position;
+            glm::vec2 uv1 = vertices[corner[1]].TexCoords - v0.TexCoords;
+            glm::vec2 uv2 = vertices[corner[2]].TexCoords - v0.TexCoords;
+            float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+            if (!std::isfinite(1.0f / determinant))
+                continue;
+            glm::vec3 tangent = (edge1 * uv2.y - edge2 * uv1.y) / determinant;
+            glm::vec3 bitangent = (edge2 * uv1.x - edge1 * uv2.x) / determinant;
+            for (int j = 0; j < 3; j++)
+            {
+                tangents[corner[j]] += tangent;
+                bitangents[corner[j]] += bitangent;
+            }
+        }
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            Vertex &vertex = vertices[i];
+            glm::vec3 normal = glm::length(vertex.Normal) > 0.0f ? glm::normalize(vertex.Normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+            glm::vec3 tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+            if (!(glm::length(tangent) > 1e-6f))
+                tangent = glm::cross(normal, std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+            tangent = glm::normalize(tangent);
+            glm::vec3 bitangent = glm::cross(normal, tangent);
+            vertex.Tangent = tangent;
+            vertex.Bitangent = glm::dot(bitangent, bitangents[i]) < 0.0f ? -bitangent : bitangent;
+        }
+    }
+
+    // the textures of a material, in the order the shaders' samplers are numbered
+    vector<Texture> loadMaterial(aiMaterial *material)
+    {
+        vector<Texture> textures;
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
         // Same applies to other texture as the following list summarizes:
@@ -163,9 +374,7 @@ private:
         // 4. height maps
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return textures;
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -177,37 +386,57 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+
+    // loads a texture of the model, or reuses it if the model loaded it before; other models' textures are shared through the TextureCache
+    Texture loadTexture(const string &path, const string &typeName)
+    {
+        unordered_map<string, unsigned int>::iterator loaded = loadedTextureIndex.find(path);
+        if(loaded != loadedTextureIndex.end())
+            return textures_loaded[loaded->second];
+        Texture texture;
+        texture.id = TextureFromFile(path.c_str(), this->directory, gammaCorrection, textureLoader);
+        texture.type = typeName;
+        texture.path = path;
+        loadedTextureIndex[texture.path] = static_cast<unsigned int>(textures_loaded.size());
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
+    }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+// loads a texture, or takes another reference on it if it's already in the TextureCache.
+// a cooked .dds next to the file (tools/texture_cooker.cpp) is uploaded as is instead of decoding the file.
+// a loader makes this return right away with a placeholder texture that is filled in later.
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, AsyncTextureLoader *loader)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    TextureCacheKey key(TextureCache::Canonical(filename), gamma);
+    const TextureCacheEntry *cached = TextureCache::Get().Acquire(key);
+    if (cached)
+        return cached->id;
+
+    CompressedImage cooked;
+    if (CompressedTexture::Load(CompressedTexture::CookedPath(filename), cooked) && CompressedTexture::Supported(cooked.format))
+    {
+        unsigned int textureID = CompressedTexture::Upload(cooked);
+        Material::InvalidateBindings();
+        TextureCache::Get().Insert(key, textureID);
+        return textureID;
+    }
+
+    if (loader)
+    {
+        unsigned int textureID = loader->Load(filename, gamma);
+        TextureCache::Get().Insert(key, textureID);
+        return textureID;
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
@@ -215,24 +444,18 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+        // the mip chain is filtered on the CPU (in linear space for gamma textures) instead of by glGenerateMipmap
+        vector<MipLevel> mips = MipGenerator::Generate(data, width, height, nrComponents, MIP_FILTER_KAISER, gamma);
+        vector<const unsigned char *> levels(1, data);
+        for (unsigned int i = 0; i < mips.size(); i++)
+            levels.push_back(mips[i].pixels.data());
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        Material::InvalidateBindings();
+        UploadTextureLevels(width, height, nrComponents, gamma, levels);
 
         stbi_image_free(data);
+        TextureCache::Get().Insert(key, textureID);
     }
     else
     {
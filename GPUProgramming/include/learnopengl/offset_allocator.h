@@ -0,0 +1,275 @@
+#ifndef OFFSET_ALLOCATOR_H
+#define OFFSET_ALLOCATOR_H
+
+#include <vector>
+
+// Hands out ranges of an abstract [0, size) space, e.g. elements of a GPU buffer; it never touches
+// the memory itself. Two level segregated fit (TLSF): free ranges are kept in 256 size classes,
+// a coarse power of two level split into 8 linear steps, with a bitmask per level, so finding a
+// large enough free range and freeing one (merging it with free neighbours) are O(1).
+// Every class covers sizes [low, next class's low); Allocate looks at classes whose low is at least
+// the request first, so any range it finds there fits, and only walks the request's own class when
+// those are empty.
+class OffsetAllocator {
+public:
+    static const unsigned int NO_SPACE = 0xFFFFFFFFu;
+
+    struct Allocation {
+        unsigned int offset; // NO_SPACE if the allocation failed
+        unsigned int node;   // internal, needed to free it
+    };
+
+    OffsetAllocator(unsigned int size = 0)
+    {
+        Reset(size);
+    }
+
+    // forgets every allocation; the whole space is free again
+    void Reset(unsigned int size)
+    {
+        nodes.clear();
+        unusedNodes.clear();
+        topMask = 0;
+        for (unsigned int i = 0; i < TOP_BINS; i++)
+            leafMasks[i] = 0;
+        for (unsigned int i = 0; i < BIN_COUNT; i++)
+            binHeads[i] = NONE;
+        capacity = size;
+        freeSpace = 0;
+        if (size > 0)
+            insertFree(0, size, NONE, NONE);
+    }
+
+    Allocation Allocate(unsigned int size)
+    {
+        Allocation allocation = { NO_SPACE, NONE };
+        if (size == 0)
+            return allocation;
+        unsigned int bin = findBin(binRoundUp(size));
+        unsigned int index = bin != NONE ? binHeads[bin] : NONE;
+        // the class below may still hold a range that is large enough, it just isn't guaranteed to
+        if (index == NONE)
+            for (index = binHeads[binRoundDown(size)]; index != NONE && nodes[index].size < size; index = nodes[index].binNext)
+                ;
+        if (index == NONE)
+            return allocation;
+
+        removeFree(index);
+        Node &node = nodes[index];
+        node.used = true;
+        // the rest of the range stays free as the node's next neighbour
+        if (node.size > size)
+        {
+            unsigned int rest = insertFree(node.offset + size, node.size - size, index, node.next);
+            Node &split = nodes[index];
+            if (split.next != NONE)
+                nodes[split.next].previous = rest;
+            split.next = rest;
+            split.size = size;
+        }
+        allocation.offset = nodes[index].offset;
+        allocation.node = index;
+        return allocation;
+    }
+
+    void Free(const Allocation &allocation)
+    {
+        if (allocation.offset == NO_SPACE || allocation.node >= nodes.size() || !nodes[allocation.node].used)
+            return;
+        unsigned int index = allocation.node;
+        unsigned int offset = nodes[index].offset;
+        unsigned int size = nodes[index].size;
+        unsigned int previous = nodes[index].previous;
+        unsigned int next = nodes[index].next;
+        // merge with free neighbours
+        if (previous != NONE && !nodes[previous].used)
+        {
+            removeFree(previous);
+            offset = nodes[previous].offset;
+            size += nodes[previous].size;
+            unsigned int before = nodes[previous].previous;
+            releaseNode(previous);
+            previous = before;
+        }
+        if (next != NONE && !nodes[next].used)
+        {
+            removeFree(next);
+            size += nodes[next].size;
+            unsigned int after = nodes[next].next;
+            releaseNode(next);
+            next = after;
+        }
+        releaseNode(index);
+        unsigned int merged = insertFree(offset, size, previous, next);
+        if (previous != NONE)
+            nodes[previous].next = merged;
+        if (next != NONE)
+            nodes[next].previous = merged;
+    }
+
+    unsigned int Size() const
+    {
+        return capacity;
+    }
+
+    unsigned int FreeSpace() const
+    {
+        return freeSpace;
+    }
+
+    // the largest request that is guaranteed to succeed right now
+    unsigned int LargestAllocation() const
+    {
+        if (topMask == 0)
+            return 0;
+        unsigned int top = 31 - leadingZeros(topMask);
+        unsigned int leaf = 31 - leadingZeros(leafMasks[top]);
+        return binSize(top * LEAF_BINS + leaf);
+    }
+
+private:
+    static const unsigned int NONE = 0xFFFFFFFFu;
+    static const unsigned int MANTISSA_BITS = 3;
+    static const unsigned int LEAF_BINS = 1 << MANTISSA_BITS;
+    static const unsigned int TOP_BINS = 32;
+    static const unsigned int BIN_COUNT = TOP_BINS * LEAF_BINS;
+
+    // a range of the space; free ones are also linked into their size class
+    struct Node {
+        unsigned int offset;
+        unsigned int size;
+        unsigned int previous; // neighbours by offset
+        unsigned int next;
+        unsigned int binPrevious;
+        unsigned int binNext;
+        bool used;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<unsigned int> unusedNodes;
+    unsigned int topMask;
+    unsigned int leafMasks[TOP_BINS];
+    unsigned int binHeads[BIN_COUNT];
+    unsigned int capacity;
+    unsigned int freeSpace;
+
+    static unsigned int leadingZeros(unsigned int value)
+    {
+        unsigned int count = 0;
+        for (unsigned int bit = 1u << 31; bit && !(value & bit); bit >>= 1)
+            count++;
+        return count;
+    }
+
+    static unsigned int trailingZeros(unsigned int value)
+    {
+        unsigned int count = 0;
+        for (; count < 32 && !(value & (1u << count)); count++)
+            ;
+        return count;
+    }
+
+    // size classes are small floats: sizes below 8 map to themselves, larger ones keep their
+    // highest bit as exponent and the 3 bits below it as mantissa
+    static unsigned int binRoundDown(unsigned int size)
+    {
+        if (size < LEAF_BINS)
+            return size;
+        unsigned int shift = 31 - leadingZeros(size) - MANTISSA_BITS;
+        return ((shift + 1) << MANTISSA_BITS) + ((size >> shift) & (LEAF_BINS - 1));
+    }
+
+    static unsigned int binRoundUp(unsigned int size)
+    {
+        if (size < LEAF_BINS)
+            return size;
+        unsigned int shift = 31 - leadingZeros(size) - MANTISSA_BITS;
+        unsigned int bin = ((shift + 1) << MANTISSA_BITS) + ((size >> shift) & (LEAF_BINS - 1));
+        // the mantissa overflows into the exponent, which is the next class up
+        return (size & ((1u << shift) - 1)) ? bin + 1 : bin;
+    }
+
+    // the smallest size in a class
+    static unsigned int binSize(unsigned int bin)
+    {
+        unsigned int exponent = bin >> MANTISSA_BITS;
+        unsigned int mantissa = bin & (LEAF_BINS - 1);
+        return exponent == 0 ? mantissa : (mantissa | LEAF_BINS) << (exponent - 1);
+    }
+
+    // the first non empty class at or above 'bin'
+    unsigned int findBin(unsigned int bin) const
+    {
+        if (bin >= BIN_COUNT)
+            return NONE;
+        unsigned int top = bin >> MANTISSA_BITS;
+        unsigned int leaves = leafMasks[top] & (0xFFFFFFFFu << (bin & (LEAF_BINS - 1)));
+        if (leaves)
+            return top * LEAF_BINS + trailingZeros(leaves);
+        unsigned int tops = top + 1 < TOP_BINS ? topMask & (0xFFFFFFFFu << (top + 1)) : 0;
+        if (!tops)
+            return NONE;
+        top = trailingZeros(tops);
+        return top * LEAF_BINS + trailingZeros(leafMasks[top]);
+    }
+
+    unsigned int newNode()
+    {
+        if (!unusedNodes.empty())
+        {
+            unsigned int index = unusedNodes.back();
+            unusedNodes.pop_back();
+            return index;
+        }
+        nodes.push_back(Node());
+        return static_cast<unsigned int>(nodes.size()) - 1;
+    }
+
+    void releaseNode(unsigned int index)
+    {
+        nodes[index].used = false;
+        nodes[index].size = 0;
+        unusedNodes.push_back(index);
+    }
+
+    unsigned int insertFree(unsigned int offset, unsigned int size, unsigned int previous, unsigned int next)
+    {
+        unsigned int index = newNode();
+        unsigned int bin = binRoundDown(size);
+        Node &node = nodes[index];
+        node.offset = offset;
+        node.size = size;
+        node.previous = previous;
+        node.next = next;
+        node.used = false;
+        node.binPrevious = NONE;
+        node.binNext = binHeads[bin];
+        if (node.binNext != NONE)
+            nodes[node.binNext].binPrevious = index;
+        binHeads[bin] = index;
+        leafMasks[bin >> MANTISSA_BITS] |= 1u << (bin & (LEAF_BINS - 1));
+        topMask |= 1u << (bin >> MANTISSA_BITS);
+        freeSpace += size;
+        return index;
+    }
+
+    void removeFree(unsigned int index)
+    {
+        Node &node = nodes[index];
+        unsigned int bin = binRoundDown(node.size);
+        if (node.binPrevious != NONE)
+            nodes[node.binPrevious].binNext = node.binNext;
+        else
+            binHeads[bin] = node.binNext;
+        if (node.binNext != NONE)
+            nodes[node.binNext].binPrevious = node.binPrevious;
+        if (binHeads[bin] == NONE)
+        {
+            leafMasks[bin >> MANTISSA_BITS] &= ~(1u << (bin & (LEAF_BINS - 1)));
+            if (leafMasks[bin >> MANTISSA_BITS] == 0)
+                topMask &= ~(1u << (bin >> MANTISSA_BITS));
+        }
+        freeSpace -= node.size;
+    }
+};
+#endif
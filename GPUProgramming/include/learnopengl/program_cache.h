@@ -0,0 +1,165 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iostream>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary). Each entry is
+// keyed by a hash of everything that can change the binary: the shader sources and defines, the
+// driver's vendor/renderer/version strings and the binary formats it supports. Any mismatch or
+// failed load simply makes the caller compile from source again and store a fresh entry.
+class ProgramCache {
+public:
+    // turns the cache on and makes sure the directory exists; without this call nothing is cached
+    static void Enable(const std::string &directory)
+    {
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        cacheDirectory() = directory;
+    }
+
+    static bool Enabled()
+    {
+        return !cacheDirectory().empty() && glExtensions().programBinary;
+    }
+
+    // 64 bit FNV-1a over the given parts plus the driver identity
+    static unsigned long long Key(const std::vector<std::string> &parts)
+    {
+        unsigned long long hash = 14695981039346656037ull;
+        for (unsigned int i = 0; i < parts.size(); i++)
+            hash = hashBytes(parts[i].data(), parts[i].size() + 1, hash); // + 1 so the terminator separates the parts
+        const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            const char *value = (const char *)glGetString(driverStrings[i]);
+            if (value)
+                hash = hashBytes(value, std::strlen(value) + 1, hash);
+        }
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        if (formatCount > 0)
+        {
+            std::vector<GLint> formats(formatCount);
+            glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+            hash = hashBytes(formats.data(), formats.size() * sizeof(GLint), hash);
+        }
+        return hash;
+    }
+
+    // tries to restore 'program' from the cache entry of 'key'. Returns true if the program is linked and usable.
+    static bool Load(GLuint program, unsigned long long key)
+    {
+        if (!Enabled())
+            return false;
+        std::ifstream file(entryPath(key).c_str(), std::ios::binary);
+        if (!file)
+            return false;
+
+        EntryHeader header;
+        std::vector<char> binary;
+        bool valid = file.read((char *)&header, sizeof(header))
+            && header.magic == MAGIC && header.version == VERSION && header.key == key && header.length > 0;
+        if (valid)
+        {
+            binary.resize(header.length);
+            valid = (bool)file.read(binary.data(), binary.size());
+        }
+        if (!valid)
+            return false;
+
+        glExtensions().ProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success != 0;
+    }
+
+    // writes the binary of a linked program (created with PrepareForStore) under 'key'
+    static void Store(GLuint program, unsigned long long key)
+    {
+        if (!Enabled())
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        EntryHeader header;
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.key = key;
+        header.length = (unsigned int)length;
+        std::vector<char> binary(length);
+        GLsizei written = 0;
+        glExtensions().GetProgramBinary(program, length, &written, &header.format, binary.data());
+        if (written <= 0)
+            return;
+        header.length = (unsigned int)written;
+
+        std::ofstream file(entryPath(key).c_str(), std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::FILE_NOT_WRITTEN: " << entryPath(key) << std::endl;
+            return;
+        }
+        file.write((const char *)&header, sizeof(header));
+        file.write(binary.data(), header.length);
+    }
+
+    // has to be called before glLinkProgram so the driver keeps the binary retrievable
+    static void PrepareForStore(GLuint program)
+    {
+        if (Enabled())
+            glExtensions().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+private:
+    static const unsigned int MAGIC = 0x42504c47; // "GLPB"
+    static const unsigned int VERSION = 1;
+
+    struct EntryHeader {
+        unsigned int       magic;
+        unsigned int       version;
+        unsigned long long key;
+        GLenum             format;
+        unsigned int       length;
+    };
+
+    static std::string &cacheDirectory()
+    {
+        static std::string directory;
+        return directory;
+    }
+
+    static std::string entryPath(unsigned long long key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", key);
+        return cacheDirectory() + "/" + name;
+    }
+
+    static unsigned long long hashBytes(const void *data, size_t size, unsigned long long hash)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+};
+#endif
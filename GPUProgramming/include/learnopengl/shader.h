@@ -4,97 +4,114 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_preprocessor.h>
+
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <vector>
+
+// 32 bit FNV-1a over a uniform name. constexpr so names written in code are hashed by the compiler;
+// pass a previous hash as 'hash' to continue hashing (e.g. "texture_diffuse" followed by "1").
+constexpr unsigned int HashUniformName(const char *name, unsigned int hash = 2166136261u)
+{
+    return *name ? HashUniformName(name + 1, (hash ^ static_cast<unsigned char>(*name)) * 16777619u) : hash;
+}
+
+// identifies a uniform by the hash of its name. Declare handles constexpr for compile-time hashing:
+//     constexpr UniformHandle MODEL("model");
+//     shader.setMat4(MODEL, model);
+struct UniformHandle {
+    unsigned int hash;
+
+    constexpr UniformHandle(const char *name) : hash(HashUniformName(name)) {}
+    UniformHandle(const std::string &name) : hash(HashUniformName(name.c_str())) {}
+    constexpr explicit UniformHandle(unsigned int hash) : hash(hash) {}
+};
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly. 'defines' are keywords compiled into this permutation (see shader_preprocessor.h).
+    // with 'async' the constructor only issues the compile/link and returns; the program may be used once isReady() is true.
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::vector<std::string> &defines = std::vector<std::string>(), bool async = false)
+        : ready(false), vertex(0), fragment(0), geometry(0), cacheKey(0)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
+        // 1. retrieve the vertex/fragment source code from filePath, with #includes resolved and the keywords defined
+        std::string vertexCode = ShaderPreprocessor::Load(vertexPath, defines);
+        std::string fragmentCode = ShaderPreprocessor::Load(fragmentPath, defines);
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        // if geometry shader path is present, also load a geometry shader
+        if(geometryPath != nullptr)
+            geometryCode = ShaderPreprocessor::Load(geometryPath, defines);
+        // 2. restore the program from the binary cache if this exact source was linked by this driver before
+        ID = glCreateProgram();
+        if (ProgramCache::Enabled())
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
+            std::string defineList;
+            for (unsigned int i = 0; i < defines.size(); i++)
+                defineList += defines[i] + ";";
+            cacheKey = ProgramCache::Key({ vertexCode, fragmentCode, geometryCode, defineList });
+            if (ProgramCache::Load(ID, cacheKey))
             {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
+                bindSharedUniformBlocks();
+                reflectUniforms();
+                ready = true;
+                return;
             }
         }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
-        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        // 3. compile shaders. The status is only checked in finishProgram(), so the driver is free to compile in the background.
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
         // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
         if(geometryPath != nullptr)
         {
             const char * gShaderCode = geometryCode.c_str();
             geometry = glCreateShader(GL_GEOMETRY_SHADER);
             glShaderSource(geometry, 1, &gShaderCode, NULL);
             glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
+        if(geometry != 0)
             glAttachShader(ID, geometry);
+        ProgramCache::PrepareForStore(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        if (!async)
+            finishProgram();
+    }
+    // true once the program is linked and usable. For async shaders this polls GL_COMPLETION_STATUS_KHR where the
+    // driver supports parallel compilation and never blocks; without that extension the first call waits for the link.
+    // ------------------------------------------------------------------------
+    bool isReady()
+    {
+        if (ready)
+            return true;
+        if (glExtensions().parallelShaderCompile)
+        {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed)
+                return false;
+        }
+        finishProgram();
+        return true;
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -102,66 +119,209 @@ public:
     { 
         glUseProgram(ID); 
     }
+    // location of a uniform from the table reflected at link time, -1 if the program has no such uniform
+    // ------------------------------------------------------------------------
+    GLint location(UniformHandle name) const
+    {
+        std::vector<std::pair<unsigned int, GLint>>::const_iterator it = std::lower_bound(uniformLocations.begin(), uniformLocations.end(), std::make_pair(name.hash, (GLint)-1));
+        return (it != uniformLocations.end() && it->first == name.hash) ? it->second : -1;
+    }
+    // texture unit a sampler uniform was assigned at link time, -1 if 'name' isn't a sampler of this program.
+    // every sampler gets its own unit, so binding textures never requires touching the sampler uniforms.
+    // ------------------------------------------------------------------------
+    GLint samplerUnit(UniformHandle name) const
+    {
+        std::vector<std::pair<unsigned int, GLint>>::const_iterator it = std::lower_bound(samplerUnits.begin(), samplerUnits.end(), std::make_pair(name.hash, (GLint)-1));
+        return (it != samplerUnits.end() && it->first == name.hash) ? it->second : -1;
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformHandle name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformHandle name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformHandle name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(location(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformHandle name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(location(name), 1, &value[0]); 
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(UniformHandle name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(location(name), x, y); 
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformHandle name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location(name), 1, &value[0]); 
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(UniformHandle name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(location(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformHandle name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(location(name), 1, &value[0]); 
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
+    void setVec4(UniformHandle name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(location(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(UniformHandle name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(UniformHandle name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(UniformHandle name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    bool ready;
+    // shader objects and cache entry of a link that hasn't been finished yet
+    unsigned int vertex, fragment, geometry;
+    unsigned long long cacheKey;
+    // uniform name hash -> location, sorted by hash
+    std::vector<std::pair<unsigned int, GLint>> uniformLocations;
+    // sampler name hash -> texture unit, sorted by hash
+    std::vector<std::pair<unsigned int, GLint>> samplerUnits;
+
+    // queries every active uniform once so that the set functions never have to ask the driver.
+    // arrays are registered both as "name" and as "name[i]" for each element.
+    // samplers are assigned consecutive texture units in reflection order.
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        uniformLocations.clear();
+        samplerUnits.clear();
+        std::vector<std::pair<GLint, GLint>> samplerLocations; // location -> unit
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLchar name[256];
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+            GLint loc = glGetUniformLocation(ID, name);
+            if (loc < 0)
+                continue; // member of a uniform block
+            std::string base(name, length);
+            if (base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+                base.resize(base.size() - 3);
+            addUniformLocation(base, loc);
+            bool sampler = isSamplerType(type);
+            if (sampler)
+            {
+                samplerUnits.push_back(std::make_pair(HashUniformName(base.c_str()), (GLint)samplerLocations.size()));
+                samplerLocations.push_back(std::make_pair(loc, (GLint)samplerLocations.size()));
+            }
+            for (GLint element = 0; size > 1 && element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(ID, elementName.c_str());
+                addUniformLocation(elementName, elementLocation);
+                if (sampler && element > 0)
+                {
+                    samplerUnits.push_back(std::make_pair(HashUniformName(elementName.c_str()), (GLint)samplerLocations.size()));
+                    samplerLocations.push_back(std::make_pair(elementLocation, (GLint)samplerLocations.size()));
+                }
+                else if (sampler)
+                    samplerUnits.push_back(std::make_pair(HashUniformName(elementName.c_str()), samplerUnits.back().second));
+            }
+        }
+        std::sort(uniformLocations.begin(), uniformLocations.end());
+        std::sort(samplerUnits.begin(), samplerUnits.end());
+
+        // the sampler -> unit assignment is program state, so it's written once here instead of per draw
+        if (!samplerLocations.empty())
+        {
+            GLint previous = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+            glUseProgram(ID);
+            for (unsigned int i = 0; i < samplerLocations.size(); i++)
+                glUniform1i(samplerLocations[i].first, samplerLocations[i].second);
+            glUseProgram((GLuint)previous);
+        }
+    }
+    static bool isSamplerType(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_RECT: case GL_INT_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_CUBE:
+        case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            return true;
+        default:
+            return false;
+        }
+    }
+    void addUniformLocation(const std::string &name, GLint loc)
+    {
+        unsigned int hash = HashUniformName(name.c_str());
+        for (unsigned int i = 0; i < uniformLocations.size(); i++)
+        {
+            if (uniformLocations[i].first == hash && uniformLocations[i].second != loc)
+                std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << name << std::endl;
+        }
+        uniformLocations.push_back(std::make_pair(hash, loc));
+    }
+    // reports compile/link errors of the finished link, stores the binary and reflects the program
+    // ------------------------------------------------------------------------
+    void finishProgram()
+    {
+        checkCompileErrors(vertex, "VERTEX");
+        checkCompileErrors(fragment, "FRAGMENT");
+        if(geometry != 0)
+            checkCompileErrors(geometry, "GEOMETRY");
+        checkCompileErrors(ID, "PROGRAM");
+        // keep the linked binary for the next launch
+        ProgramCache::Store(ID, cacheKey);
+        bindSharedUniformBlocks();
+        reflectUniforms();
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(geometry != 0)
+            glDeleteShader(geometry);
+        vertex = fragment = geometry = 0;
+        ready = true;
+    }
+    // attaches the program's shared uniform blocks (see frame_uniforms.h) to their fixed binding points.
+    // programs that don't declare a block are left alone.
+    // ------------------------------------------------------------------------
+    void bindSharedUniformBlocks()
+    {
+        GLuint frameBlock = glGetUniformBlockIndex(ID, FRAME_UNIFORMS_BLOCK);
+        if (frameBlock != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, frameBlock, FRAME_UNIFORMS_BINDING);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
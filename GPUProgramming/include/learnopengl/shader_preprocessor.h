@@ -0,0 +1,105 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <set>
+#include <vector>
+
+// Minimal GLSL preprocessing done before the source reaches the driver:
+// - '#include "file"' is replaced by the file's content, resolved relative to the including file.
+//   Every file is included at most once per shader (like #pragma once), which also breaks cycles.
+// - every keyword of 'defines' is inserted as '#define KEYWORD 1' right after the #version line,
+//   so permutations are specialized by the compiler instead of branching on uniforms.
+class ShaderPreprocessor {
+public:
+    // returns the expanded source of 'path', or an empty string if a file couldn't be read
+    static std::string Load(const std::string &path, const std::vector<std::string> &defines)
+    {
+        std::set<std::string> included;
+        std::string source;
+        if (!expand(path, included, source))
+            return std::string();
+        return injectDefines(source, defines);
+    }
+
+private:
+    static std::string directoryOf(const std::string &path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    static bool expand(const std::string &path, std::set<std::string> &included, std::string &out)
+    {
+        if (!included.insert(path).second)
+            return true;
+
+        std::string code;
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path.c_str());
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            code = stream.str();
+        }
+        catch (std::ifstream::failure &e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << " " << e.what() << std::endl;
+            return false;
+        }
+
+        std::istringstream lines(code);
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(lines, line))
+        {
+            lineNumber++;
+            size_t directive = line.find_first_not_of(" \t");
+            if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0)
+            {
+                size_t open = line.find('"', directive + 8);
+                size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+                if (close == std::string::npos)
+                {
+                    std::cout << "ERROR::SHADER::MALFORMED_INCLUDE: " << path << "(" << lineNumber << ")" << std::endl;
+                    return false;
+                }
+                if (!expand(directoryOf(path) + line.substr(open + 1, close - open - 1), included, out))
+                    return false;
+                // keep compiler messages pointing at the right line of this file
+                out += "#line " + std::to_string(lineNumber + 1) + "\n";
+                continue;
+            }
+            out += line;
+            out += '\n';
+        }
+        return true;
+    }
+
+    static std::string injectDefines(const std::string &source, const std::vector<std::string> &defines)
+    {
+        if (defines.empty())
+            return source;
+        size_t version = source.find("#version");
+        size_t insertAt = version == std::string::npos ? 0 : source.find('\n', version);
+        insertAt = insertAt == std::string::npos ? source.size() : insertAt + 1;
+        unsigned int versionLine = 1;
+        for (size_t i = 0; i < insertAt && i < source.size(); i++)
+            if (source[i] == '\n')
+                versionLine++;
+
+        std::string block;
+        for (unsigned int i = 0; i < defines.size(); i++)
+            block += "#define " + defines[i] + " 1\n";
+        block += "#line " + std::to_string(versionLine) + "\n";
+        return source.substr(0, insertAt) + block + source.substr(insertAt);
+    }
+};
+#endif
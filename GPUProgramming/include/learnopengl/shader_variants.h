@@ -0,0 +1,66 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <learnopengl/shader.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// A shader together with the keywords (e.g. ALPHA_TEST, INSTANCED, SKINNED) it can be specialized
+// for. A permutation is identified by a bit mask over the keyword list; it is compiled the first
+// time it is requested and kept afterwards, so only permutations that are actually drawn cost
+// compile time. Async variants return as soon as the compile is issued; check Shader::isReady()
+// before drawing with them (e.g. request every permutation of a level up front, draw when ready).
+class ShaderVariants {
+public:
+    // constructor only records the sources; nothing is compiled yet
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, const std::vector<std::string> &keywords, const char *geometryPath = nullptr, bool async = false)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : ""), keywords(keywords), async(async)
+    {
+        if (keywords.size() > 32)
+            std::cout << "ERROR::SHADER_VARIANTS::TOO_MANY_KEYWORDS: " << vertexPath << std::endl;
+    }
+
+    // bit of a keyword in a permutation key, 0 if the shader doesn't know the keyword
+    unsigned int Keyword(const std::string &keyword) const
+    {
+        for (unsigned int i = 0; i < keywords.size() && i < 32; i++)
+            if (keywords[i] == keyword)
+                return 1u << i;
+        return 0;
+    }
+
+    // returns the permutation for 'key', compiling it on first use (without waiting for it when async)
+    Shader &Get(unsigned int key)
+    {
+        std::map<unsigned int, Shader>::iterator it = variants.find(key);
+        if (it != variants.end())
+            return it->second;
+
+        std::vector<std::string> defines;
+        for (unsigned int i = 0; i < keywords.size() && i < 32; i++)
+            if (key & (1u << i))
+                defines.push_back(keywords[i]);
+        Shader shader(vertexPath.c_str(), fragmentPath.c_str(), geometryPath.empty() ? nullptr : geometryPath.c_str(), defines, async);
+        return variants.insert(std::make_pair(key, shader)).first->second;
+    }
+
+    // deletes every compiled permutation
+    void Release()
+    {
+        for (std::map<unsigned int, Shader>::iterator it = variants.begin(); it != variants.end(); ++it)
+            glDeleteProgram(it->second.ID);
+        variants.clear();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath;
+    std::vector<std::string> keywords;
+    bool async;
+    std::map<unsigned int, Shader> variants;
+};
+#endif
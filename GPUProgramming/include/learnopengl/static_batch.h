@@ -0,0 +1,151 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// a contiguous run of vertices inside the batch that belongs to one static surface
+struct BatchRange {
+    unsigned int material;
+    GLint        first;
+    GLsizei      count;
+};
+
+// Packs all static, already world-space geometry that shares one interleaved float vertex layout
+// into a single VAO/VBO. Ranges are grouped by material at build time so every material can be
+// submitted with one glMultiDrawArrays call instead of one bind/uniform/draw per surface.
+// A layered batch appends a per-vertex texture array layer after the given attributes, so surfaces
+// with different textures of the same array can share a material (see texture_array.h).
+class StaticBatch {
+public:
+    // batch data
+    vector<float>      vertices;
+    vector<BatchRange> ranges;
+    unsigned int VAO;
+
+    // constructor, expects the number of float components of each vertex attribute in order (e.g. {3, 2} for position + uv)
+    StaticBatch(vector<unsigned int> attributeSizes, bool layered = false) : VAO(0), VBO(0), floatsPerVertex(0)
+    {
+        this->attributeSizes = attributeSizes;
+        if (layered)
+            this->attributeSizes.push_back(1);
+        for (unsigned int i = 0; i < this->attributeSizes.size(); i++)
+            floatsPerVertex += this->attributeSizes[i];
+        sourceFloats = layered ? floatsPerVertex - 1 : floatsPerVertex;
+    }
+
+    // appends a surface of 'vertexCount' interleaved vertices drawn with 'material'. Must be called before Build().
+    // 'data' holds the constructor's attributes only; a layered batch adds 'layer' to every vertex itself.
+    void AddSurface(const float *data, unsigned int vertexCount, unsigned int material, unsigned int layer = 0)
+    {
+        BatchRange range;
+        range.material = material;
+        range.first = static_cast<GLint>(vertices.size() / floatsPerVertex);
+        range.count = static_cast<GLsizei>(vertexCount);
+        for (unsigned int i = 0; i < vertexCount; i++)
+        {
+            vertices.insert(vertices.end(), data + i * sourceFloats, data + (i + 1) * sourceFloats);
+            if (sourceFloats != floatsPerVertex)
+                vertices.push_back(static_cast<float>(layer));
+        }
+        ranges.push_back(range);
+    }
+
+    // sorts the surfaces by material, uploads the packed vertex data and builds the per-material multi-draw tables
+    void Build()
+    {
+        // reorder the vertex data so that all ranges of a material are adjacent in the buffer
+        vector<BatchRange> sorted = ranges;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const BatchRange &a, const BatchRange &b) { return a.material < b.material; });
+        vector<float> packed;
+        packed.reserve(vertices.size());
+        for (unsigned int i = 0; i < sorted.size(); i++)
+        {
+            const float *src = &vertices[sorted[i].first * floatsPerVertex];
+            sorted[i].first = static_cast<GLint>(packed.size() / floatsPerVertex);
+            packed.insert(packed.end(), src, src + sorted[i].count * floatsPerVertex);
+        }
+        vertices.swap(packed);
+        ranges.swap(sorted);
+
+        // one first/count table per material, ready to be handed to glMultiDrawArrays as is.
+        // after sorting, ranges of a material are back to back, so they collapse into one record.
+        unsigned int materialCount = ranges.empty() ? 0 : ranges.back().material + 1;
+        firsts.assign(materialCount, vector<GLint>());
+        counts.assign(materialCount, vector<GLsizei>());
+        for (unsigned int i = 0; i < ranges.size(); i++)
+        {
+            vector<GLint> &first = firsts[ranges[i].material];
+            vector<GLsizei> &count = counts[ranges[i].material];
+            if (!first.empty() && first.back() + count.back() == ranges[i].first)
+            {
+                count.back() += ranges[i].count;
+                continue;
+            }
+            firsts[ranges[i].material].push_back(ranges[i].first);
+            counts[ranges[i].material].push_back(ranges[i].count);
+        }
+
+        setupBatch();
+    }
+
+    // number of material slots; materials without any surface are valid but draw nothing
+    unsigned int MaterialCount() const
+    {
+        return static_cast<unsigned int>(firsts.size());
+    }
+
+    // draws every surface that uses 'material'. The VAO has to be bound with Bind() beforehand.
+    void Draw(unsigned int material) const
+    {
+        if (material >= firsts.size() || firsts[material].empty())
+            return;
+        glMultiDrawArrays(GL_TRIANGLES, firsts[material].data(), counts[material].data(), static_cast<GLsizei>(firsts[material].size()));
+    }
+
+    void Bind() const
+    {
+        glBindVertexArray(VAO);
+    }
+
+    // frees the GL objects of the batch
+    void Release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+    }
+
+private:
+    // render data
+    unsigned int VBO;
+    vector<unsigned int> attributeSizes;
+    unsigned int floatsPerVertex;
+    unsigned int sourceFloats;
+    vector<vector<GLint>>   firsts;
+    vector<vector<GLsizei>> counts;
+
+    // creates the shared vertex buffer and its attribute pointers
+    void setupBatch()
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+        unsigned int offset = 0;
+        for (unsigned int i = 0; i < attributeSizes.size(); i++)
+        {
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, attributeSizes[i], GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void*)(offset * sizeof(float)));
+            offset += attributeSizes[i];
+        }
+        glBindVertexArray(0);
+    }
+};
+#endif
@@ -0,0 +1,260 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/compressed_texture.h>
+#include <learnopengl/mip_generator.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <vector>
+using namespace std;
+
+// where a texture ended up: which array (group) and which layer inside it
+struct TextureLayer {
+    unsigned int group;
+    unsigned int layer;
+};
+
+// all layers of one GL_TEXTURE_2D_ARRAY share size and format
+struct TextureArrayGroup {
+    int width;
+    int height;
+    int components;
+    // block compressed internal format, 0 for plain 8 bit layers
+    GLenum compressedFormat;
+    BlockFormat blockFormat;
+    // mip levels stored per layer; compressed layers bring their own chain
+    unsigned int levels;
+    unsigned int id;
+    // per layer: the pixels, or every compressed level back to back
+    vector<vector<unsigned char>> layers;
+};
+
+// Collects decoded images into GL_TEXTURE_2D_ARRAY layers grouped by size and format, so that
+// geometry using different textures of a group can be drawn together and select its texture with
+// a layer index instead of a glBindTexture between draws.
+class TextureArrays {
+public:
+    vector<TextureArrayGroup> groups;
+
+    // if a layer size is given every image is converted to RGBA and resampled to it, so all of them share one array
+    TextureArrays(int layerWidth = 0, int layerHeight = 0) : layerWidth(layerWidth), layerHeight(layerHeight)
+    {
+    }
+
+    // adds a decoded 8 bit image as a new layer and returns its location. Must be called before Build().
+    TextureLayer AddLayer(const unsigned char *data, int width, int height, int components)
+    {
+        vector<unsigned char> pixels;
+        if (layerWidth > 0 && layerHeight > 0)
+        {
+            pixels = conform(data, width, height, components);
+            width = layerWidth;
+            height = layerHeight;
+            components = 4;
+        }
+        else
+            pixels.assign(data, data + width * height * components);
+
+        TextureLayer location;
+        location.group = findGroup(width, height, components, 0, 1);
+        location.layer = static_cast<unsigned int>(groups[location.group].layers.size());
+        groups[location.group].layers.push_back(std::move(pixels));
+        return location;
+    }
+
+    // adds a block compressed image as a new layer. Fails if the format isn't supported or the image
+    // doesn't match the fixed layer size, since compressed blocks can't be resampled here.
+    bool AddCompressedLayer(const CompressedImage &image, TextureLayer &location)
+    {
+        if (!CompressedTexture::Supported(image.format) || image.levels.empty())
+            return false;
+        if (layerWidth > 0 && layerHeight > 0 && (image.width != layerWidth || image.height != layerHeight))
+            return false;
+
+        vector<unsigned char> blocks;
+        for (unsigned int level = 0; level < image.levels.size(); level++)
+            blocks.insert(blocks.end(), image.levels[level].begin(), image.levels[level].end());
+        GLenum format = CompressedTexture::InternalFormat(image.format, image.srgb);
+        location.group = findGroup(image.width, image.height, 4, format, static_cast<unsigned int>(image.levels.size()));
+        groups[location.group].blockFormat = image.format;
+        location.layer = static_cast<unsigned int>(groups[location.group].layers.size());
+        groups[location.group].layers.push_back(std::move(blocks));
+        return true;
+    }
+
+    // uploads every group into its own texture array and releases the CPU copies. The mip chains
+    // are built on the CPU by MipGenerator, one job per layer on 'pool' if there is one.
+    void Build(ThreadPool *pool = nullptr)
+    {
+        vector<vector<std::future<vector<MipLevel>>>> mips(groups.size());
+        for (unsigned int i = 0; i < groups.size(); i++)
+        {
+            const TextureArrayGroup &group = groups[i];
+            if (group.compressedFormat)
+                continue;
+            for (unsigned int layer = 0; layer < group.layers.size(); layer++)
+            {
+                const unsigned char *pixels = group.layers[layer].data();
+                int width = group.width, height = group.height, components = group.components;
+                std::function<vector<MipLevel>()> job = [pixels, width, height, components]() {
+                    return MipGenerator::Generate(pixels, width, height, components);
+                };
+                mips[i].push_back(pool ? pool->Async(job) : std::async(std::launch::deferred, job));
+            }
+        }
+
+        for (unsigned int i = 0; i < groups.size(); i++)
+        {
+            TextureArrayGroup &group = groups[i];
+            if (group.compressedFormat)
+            {
+                buildCompressed(group);
+                continue;
+            }
+            GLenum internalFormat = TextureInternalFormat(group.components, false);
+            GLenum format = TextureFormat(group.components);
+            GLsizei layerCount = static_cast<GLsizei>(group.layers.size());
+            GLsizei levelCount = static_cast<GLsizei>(MipGenerator::LevelCount(group.width, group.height));
+
+            glGenTextures(1, &group.id);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, group.id);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            if (glExtensions().textureStorage)
+                glExtensions().TexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, internalFormat, group.width, group.height, layerCount);
+            else
+                for (GLsizei level = 0; level < levelCount; level++)
+                    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, std::max(group.width >> level, 1), std::max(group.height >> level, 1), layerCount, 0, format, GL_UNSIGNED_BYTE, NULL);
+            for (GLsizei layer = 0; layer < layerCount; layer++)
+            {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, group.width, group.height, 1, format, GL_UNSIGNED_BYTE, group.layers[layer].data());
+                vector<MipLevel> chain = mips[i][layer].get();
+                for (unsigned int level = 0; level < chain.size(); level++)
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level + 1, 0, 0, layer, chain[level].width, chain[level].height, 1, format, GL_UNSIGNED_BYTE, chain[level].pixels.data());
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            vector<vector<unsigned char>>().swap(group.layers);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    // binds the array of a group to the currently active texture unit
+    void Bind(unsigned int group) const
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, groups[group].id);
+    }
+
+    // frees all texture arrays
+    void Release()
+    {
+        TextureCache::Get().ForgetContainer(this);
+        for (unsigned int i = 0; i < groups.size(); i++)
+            glDeleteTextures(1, &groups[i].id);
+        groups.clear();
+    }
+
+private:
+    int layerWidth;
+    int layerHeight;
+
+    unsigned int findGroup(int width, int height, int components, GLenum compressedFormat, unsigned int levels)
+    {
+        for (unsigned int i = 0; i < groups.size(); i++)
+            if (groups[i].width == width && groups[i].height == height && groups[i].components == components
+                && groups[i].compressedFormat == compressedFormat && groups[i].levels == levels)
+                return i;
+        TextureArrayGroup group;
+        group.width = width;
+        group.height = height;
+        group.components = components;
+        group.compressedFormat = compressedFormat;
+        group.blockFormat = BLOCK_FORMAT_BC7;
+        group.levels = levels;
+        group.id = 0;
+        groups.push_back(group);
+        return static_cast<unsigned int>(groups.size() - 1);
+    }
+
+    // uploads the block levels of all layers as they are, one glCompressedTexImage3D per level
+    void buildCompressed(TextureArrayGroup &group)
+    {
+        GLsizei layerCount = static_cast<GLsizei>(group.layers.size());
+        glGenTextures(1, &group.id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, group.id);
+        size_t offset = 0;
+        vector<unsigned char> level;
+        for (unsigned int i = 0; i < group.levels; i++)
+        {
+            int width = std::max(group.width >> i, 1);
+            int height = std::max(group.height >> i, 1);
+            size_t levelSize = CompressedTexture::LevelSize(group.blockFormat, width, height);
+            level.resize(levelSize * layerCount);
+            for (GLsizei layer = 0; layer < layerCount; layer++)
+                std::copy(group.layers[layer].begin() + offset, group.layers[layer].begin() + offset + levelSize, level.begin() + levelSize * layer);
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, group.compressedFormat, width, height, layerCount, 0, (GLsizei)level.size(), level.data());
+            offset += levelSize;
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)group.levels - 1);
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, group.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        vector<vector<unsigned char>>().swap(group.layers);
+    }
+
+    // expands the image to RGBA and bilinearly resamples it to the fixed layer size
+    vector<unsigned char> conform(const unsigned char *data, int width, int height, int components) const
+    {
+        vector<unsigned char> pixels(layerWidth * layerHeight * 4);
+        for (int y = 0; y < layerHeight; y++)
+        {
+            float sy = std::max(0.0f, (y + 0.5f) * height / layerHeight - 0.5f);
+            int y0 = std::min(static_cast<int>(sy), height - 1);
+            int y1 = std::min(y0 + 1, height - 1);
+            float fy = sy - y0;
+            for (int x = 0; x < layerWidth; x++)
+            {
+                float sx = std::max(0.0f, (x + 0.5f) * width / layerWidth - 0.5f);
+                int x0 = std::min(static_cast<int>(sx), width - 1);
+                int x1 = std::min(x0 + 1, width - 1);
+                float fx = sx - x0;
+
+                float texel[4] = { 0.0f, 0.0f, 0.0f, 255.0f };
+                for (int c = 0; c < components; c++)
+                {
+                    float top    = data[(y0 * width + x0) * components + c] * (1.0f - fx) + data[(y0 * width + x1) * components + c] * fx;
+                    float bottom = data[(y1 * width + x0) * components + c] * (1.0f - fx) + data[(y1 * width + x1) * components + c] * fx;
+                    texel[c] = top * (1.0f - fy) + bottom * fy;
+                }
+                // grey (+ alpha) images are replicated into the colour channels
+                if (components <= 2)
+                {
+                    if (components == 2)
+                        texel[3] = texel[1];
+                    texel[1] = texel[2] = texel[0];
+                }
+
+                unsigned char *dst = &pixels[(y * layerWidth + x) * 4];
+                for (int c = 0; c < 4; c++)
+                    dst[c] = static_cast<unsigned char>(texel[c] + 0.5f);
+            }
+        }
+        return pixels;
+    }
+};
+#endif
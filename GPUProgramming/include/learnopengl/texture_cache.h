@@ -0,0 +1,151 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/material.h>
+
+#include <cctype>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// what a texture was loaded as. Two loads share a texture only if every field matches.
+struct TextureCacheKey {
+    // canonical file path, see TextureCache::Canonical
+    std::string path;
+    bool gamma;
+    // GL_TEXTURE_2D for standalone textures, GL_TEXTURE_2D_ARRAY for layers of a texture array
+    GLenum target;
+    // the TextureArrays a layer lives in, null for standalone textures
+    const void *container;
+
+    TextureCacheKey(const std::string &path, bool gamma, GLenum target = GL_TEXTURE_2D, const void *container = nullptr)
+        : path(path), gamma(gamma), target(target), container(container)
+    {
+    }
+
+    bool operator==(const TextureCacheKey &other) const
+    {
+        return gamma == other.gamma && target == other.target && container == other.container && path == other.path;
+    }
+};
+
+struct TextureCacheKeyHash {
+    size_t operator()(const TextureCacheKey &key) const
+    {
+        size_t hash = std::hash<std::string>()(key.path);
+        hash ^= std::hash<const void *>()(key.container) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        return hash ^ ((size_t)key.target << 1) ^ (size_t)key.gamma;
+    }
+};
+
+struct TextureCacheEntry {
+    // GL texture name, or the texture array group for layers
+    unsigned int id;
+    unsigned int layer;
+    unsigned int refCount;
+};
+
+// Process-wide cache of loaded textures, so every Model (and main's texture arrays) that uses the
+// same file with the same load parameters shares one decode and one GPU copy. Lookups are hashed,
+// and entries are reference counted: the GL texture of a standalone entry is deleted when its last
+// user releases it. Layers are owned by their TextureArrays and only forgotten here.
+class TextureCache {
+public:
+    static TextureCache &Get()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    // normalizes separators, '.' and '..' so different spellings of a path share an entry
+    static std::string Canonical(const std::string &path)
+    {
+        std::vector<std::string> parts;
+        bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+        size_t start = 0;
+        while (start <= path.size())
+        {
+            size_t end = path.find_first_of("/\\", start);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string part = path.substr(start, end - start);
+            if (part == "..")
+            {
+                if (!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else if (!absolute)
+                    parts.push_back(part);
+            }
+            else if (!part.empty() && part != ".")
+                parts.push_back(part);
+            start = end + 1;
+        }
+        std::string canonical = absolute ? "/" : "";
+        for (unsigned int i = 0; i < parts.size(); i++)
+            canonical += (i ? "/" : "") + parts[i];
+#ifdef _WIN32
+        // the file system is case insensitive
+        for (unsigned int i = 0; i < canonical.size(); i++)
+            canonical[i] = (char)std::tolower((unsigned char)canonical[i]);
+#endif
+        return canonical;
+    }
+
+    // returns the entry of 'key' and takes a reference on it, or null if nothing was loaded for the key yet
+    const TextureCacheEntry *Acquire(const TextureCacheKey &key)
+    {
+        std::unordered_map<TextureCacheKey, TextureCacheEntry, TextureCacheKeyHash>::iterator it = entries.find(key);
+        if (it == entries.end())
+            return nullptr;
+        it->second.refCount++;
+        return &it->second;
+    }
+
+    // registers a freshly loaded texture; the caller holds the first reference
+    const TextureCacheEntry &Insert(const TextureCacheKey &key, unsigned int id, unsigned int layer = 0)
+    {
+        TextureCacheEntry entry;
+        entry.id = id;
+        entry.layer = layer;
+        entry.refCount = 1;
+        return entries[key] = entry;
+    }
+
+    // drops one reference; the last one deletes a standalone texture
+    void Release(const TextureCacheKey &key)
+    {
+        std::unordered_map<TextureCacheKey, TextureCacheEntry, TextureCacheKeyHash>::iterator it = entries.find(key);
+        if (it == entries.end() || --it->second.refCount > 0)
+            return;
+        if (key.target == GL_TEXTURE_2D)
+        {
+            glDeleteTextures(1, &it->second.id);
+            // the name can be handed out again, so the tracked unit bindings are stale now
+            Material::InvalidateBindings();
+        }
+        entries.erase(it);
+    }
+
+    // forgets every layer of a texture array container that is going away
+    void ForgetContainer(const void *container)
+    {
+        for (std::unordered_map<TextureCacheKey, TextureCacheEntry, TextureCacheKeyHash>::iterator it = entries.begin(); it != entries.end();)
+        {
+            if (it->first.container == container)
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+private:
+    std::unordered_map<TextureCacheKey, TextureCacheEntry, TextureCacheKeyHash> entries;
+
+    TextureCache() {}
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+};
+#endif
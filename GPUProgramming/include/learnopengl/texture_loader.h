@@ -0,0 +1,348 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/image_decoder.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/material.h>
+#include <learnopengl/mip_generator.h>
+#include <learnopengl/thread_pool.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// an image decoded by a worker thread; owns the stb_image pixel buffer
+struct DecodedImage {
+    unsigned char *data;
+    int width;
+    int height;
+    int components;
+
+    DecodedImage() : data(NULL), width(0), height(0), components(0) {}
+    ~DecodedImage()
+    {
+        if (data)
+            stbi_image_free(data);
+    }
+    DecodedImage(const DecodedImage &) = delete;
+    DecodedImage &operator=(const DecodedImage &) = delete;
+};
+
+typedef std::shared_future<std::shared_ptr<DecodedImage>> DecodedImageFuture;
+
+// sized internal format of an 8 bit image; only colour images have an sRGB format
+inline GLenum TextureInternalFormat(int components, bool srgb)
+{
+    if (components == 1)
+        return GL_R8;
+    else if (components == 2)
+        return GL_RG8;
+    else if (components == 3)
+        return srgb ? GL_SRGB8 : GL_RGB8;
+    return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+}
+
+inline GLenum TextureFormat(int components)
+{
+    if (components == 1)
+        return GL_RED;
+    else if (components == 2)
+        return GL_RG;
+    else if (components == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+// allocates every level of the GL_TEXTURE_2D bound to the active unit, as immutable storage where
+// available, and uploads 'levels' into them. The level pointers are offsets while a pixel unpack
+// buffer is bound.
+inline void UploadTextureLevels(int width, int height, int components, bool srgb, const std::vector<const unsigned char *> &levels)
+{
+    GLenum internalFormat = TextureInternalFormat(components, srgb);
+    GLenum format = TextureFormat(components);
+    GLsizei levelCount = static_cast<GLsizei>(levels.size());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (glExtensions().textureStorage)
+    {
+        glExtensions().TexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, width, height);
+        for (GLsizei level = 0; level < levelCount; level++)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, std::max(width >> level, 1), std::max(height >> level, 1), format, GL_UNSIGNED_BYTE, levels[level]);
+    }
+    else
+    {
+        for (GLsizei level = 0; level < levelCount; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, std::max(width >> level, 1), std::max(height >> level, 1), 0, format, GL_UNSIGNED_BYTE, levels[level]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Loads textures without stalling the GL thread. Load() hands out the texture name right away; it
+// shows a 1x1 placeholder until its upload landed. A worker maps the file and reads the image size,
+// then Update() hands it a mapped pixel buffer object from a small ring, at most 'uploadBudget'
+// bytes per call, and the worker decodes (in its ImageArena) and writes the whole mip chain straight
+// into it. Without mipmaps stb_image decodes directly into the buffer. The GL thread only unmaps and
+// issues the uploads. A PBO is only reused once the fence of its previous upload has signalled, so
+// the CPU never waits for the driver.
+class AsyncTextureLoader {
+public:
+    AsyncTextureLoader(ThreadPool &pool, unsigned int ringSize = 4) : pool(pool), next(0)
+    {
+        ring.resize(ringSize);
+        for (unsigned int i = 0; i < ring.size(); i++)
+        {
+            glGenBuffers(1, &ring[i].pbo);
+            ring[i].size = 0;
+            ring[i].fence = 0;
+            ring[i].mapped = false;
+        }
+    }
+
+    // starts decoding 'path' into CPU memory on the pool; repeated requests for a path share one decode
+    DecodedImageFuture Decode(const std::string &path)
+    {
+        std::unordered_map<std::string, DecodedImageFuture>::iterator it = decodes.find(path);
+        if (it != decodes.end())
+            return it->second;
+        DecodedImageFuture image = pool.Async([path]() {
+            std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+            MappedFile file(path);
+            image->data = ImageDecoder::Decode(file, image->width, image->height, image->components);
+            if (!image->data)
+                std::cout << "Texture failed to load at path: " << path << std::endl;
+            return image;
+        }).share();
+        decodes[path] = image;
+        return image;
+    }
+
+    // returns a texture name immediately; the image is decoded in the background and uploaded by
+    // Update(). 'gamma' stores the texture as sRGB, 'mipmaps' builds the chain with MipGenerator.
+    unsigned int Load(const std::string &path, bool gamma = false, bool mipmaps = true)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        Material::InvalidateBindings();
+
+        PendingUpload upload;
+        upload.texture = textureID;
+        upload.srgb = gamma;
+        upload.mipmaps = mipmaps;
+        upload.buffer = -1;
+        upload.source = pool.Async([path]() {
+            std::shared_ptr<ImageSource> source = std::make_shared<ImageSource>();
+            source->path = path;
+            source->valid = source->file.Open(path) && ImageDecoder::Info(source->file, source->width, source->height, source->components);
+            return source;
+        }).share();
+        pending.push_back(std::move(upload));
+        return textureID;
+    }
+
+    // uploads the images whose buffers were filled, then hands buffers to the next probed images until
+    // 'uploadBudget' bytes are used up. Call once per frame. An image larger than the budget still gets
+    // a buffer when it's the first one of the frame, so it can't starve. Returns the number of textures
+    // uploaded; it rebinds GL_TEXTURE_2D on the active unit when that is not 0.
+    unsigned int Update(size_t uploadBudget)
+    {
+        unsigned int count = 0;
+        bool boundPBO = false;
+
+        // uploads complete in Load() order
+        while (!pending.empty())
+        {
+            PendingUpload &upload = pending.front();
+            if (upload.buffer == -1 || (upload.buffer >= 0 && upload.filled.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+                break;
+            std::shared_ptr<ImageSource> source = upload.source.get();
+            if (upload.buffer >= 0)
+            {
+                UploadBuffer &buffer = ring[upload.buffer];
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+                boundPBO = true;
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                buffer.mapped = false;
+                if (upload.filled.get())
+                {
+                    std::vector<const unsigned char *> levels;
+                    size_t offset = 0;
+                    unsigned int levelCount = upload.mipmaps ? MipGenerator::LevelCount(source->width, source->height) : 1;
+                    for (unsigned int level = 0; level < levelCount; level++)
+                    {
+                        levels.push_back((const unsigned char *)offset);
+                        offset += (size_t)std::max(source->width >> level, 1) * std::max(source->height >> level, 1) * source->components;
+                    }
+                    glBindTexture(GL_TEXTURE_2D, upload.texture);
+                    // Material's tracked binding of the active unit is stale now
+                    Material::InvalidateBindings();
+                    UploadTextureLevels(source->width, source->height, source->components, upload.srgb, levels);
+                    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                    count++;
+                }
+                else
+                    std::cout << "Texture failed to load at path: " << source->path << std::endl;
+            }
+            else
+                std::cout << "Texture failed to load at path: " << source->path << std::endl;
+            pending.pop_front();
+        }
+
+        size_t handedOut = 0;
+        for (unsigned int i = 0; i < pending.size(); i++)
+        {
+            PendingUpload &upload = pending[i];
+            if (upload.buffer != -1)
+                continue;
+            if (upload.source.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                break; // keep the upload order; the next image is rarely much further ahead
+            std::shared_ptr<ImageSource> source = upload.source.get();
+            if (!source->valid)
+            {
+                upload.buffer = -2;
+                continue;
+            }
+            size_t size = upload.mipmaps ? MipGenerator::ChainSize(source->width, source->height, source->components)
+                                         : (size_t)source->width * source->height * source->components;
+            if (handedOut > 0 && handedOut + size > uploadBudget)
+                break;
+
+            // the next buffer of the ring must be done with its previous upload
+            UploadBuffer &buffer = ring[next];
+            if (buffer.mapped)
+                break;
+            if (buffer.fence)
+            {
+                if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                    break;
+                glDeleteSync(buffer.fence);
+                buffer.fence = 0;
+            }
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+            boundPBO = true;
+            if (buffer.size < size)
+            {
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+                buffer.size = size;
+            }
+            // the chain is only written; a direct decode reads back its previous PNG rows
+            GLbitfield access = upload.mipmaps ? GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT : GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+            unsigned char *destination = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, access);
+            if (!destination)
+                break;
+            buffer.mapped = true;
+            upload.buffer = (int)next;
+            next = (next + 1) % ring.size();
+            handedOut += size;
+
+            bool mipmaps = upload.mipmaps, srgb = upload.srgb;
+            upload.filled = pool.Async([source, destination, size, mipmaps, srgb]() {
+                if (!mipmaps)
+                    return ImageDecoder::DecodeInto(source->file, destination, size);
+                ImageArena::Scope scope;
+                int width, height, components;
+                unsigned char *pixels = ImageDecoder::Decode(source->file, width, height, components);
+                bool valid = pixels && width == source->width && height == source->height && components == source->components;
+                if (valid)
+                    MipGenerator::GenerateInto(pixels, width, height, components, destination, MIP_FILTER_KAISER, srgb);
+                stbi_image_free(pixels);
+                return valid;
+            }).share();
+        }
+        if (boundPBO)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return count;
+    }
+
+    // drops the decoded pixels of 'path' once the caller is done with them
+    void Discard(const std::string &path)
+    {
+        decodes.erase(path);
+    }
+
+    // number of textures still showing their placeholder
+    unsigned int Pending() const
+    {
+        return static_cast<unsigned int>(pending.size());
+    }
+
+    // frees the PBO ring; pending textures keep their placeholder
+    void Release()
+    {
+        // workers may still be writing into mapped buffers
+        for (unsigned int i = 0; i < pending.size(); i++)
+            if (pending[i].buffer >= 0)
+                pending[i].filled.wait();
+        for (unsigned int i = 0; i < ring.size(); i++)
+        {
+            if (ring[i].mapped)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring[i].pbo);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            if (ring[i].fence)
+                glDeleteSync(ring[i].fence);
+            glDeleteBuffers(1, &ring[i].pbo);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ring.clear();
+        pending.clear();
+    }
+
+private:
+    // a mapped source file and its header, read by a worker
+    struct ImageSource {
+        std::string path;
+        MappedFile file;
+        int width;
+        int height;
+        int components;
+        bool valid;
+    };
+
+    struct PendingUpload {
+        unsigned int texture;
+        bool srgb;
+        bool mipmaps;
+        std::shared_future<std::shared_ptr<ImageSource>> source;
+        // ring buffer being filled, -1 while waiting for one, -2 if the file couldn't be read
+        int buffer;
+        std::shared_future<bool> filled;
+    };
+
+    struct UploadBuffer {
+        unsigned int pbo;
+        size_t size;
+        GLsync fence;
+        bool mapped;
+    };
+
+    ThreadPool &pool;
+    std::unordered_map<std::string, DecodedImageFuture> decodes;
+    std::deque<PendingUpload> pending;
+    std::vector<UploadBuffer> ring;
+    unsigned int next;
+};
+#endif
@@ -0,0 +1,155 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads for CPU side loading work (image decoding, mesh conversion, ...).
+// Jobs never touch GL; results are handed back to the GL thread by whoever submitted them.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread minus the one running the GL context
+    ThreadPool(unsigned int threadCount = 0) : stopping(false), busy(0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.push_back(std::thread(&ThreadPool::work, this));
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int Size() const
+    {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    // queues a job without a result
+    void Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    // queues a job and returns a future for its result
+    template <typename F>
+    std::future<decltype(std::declval<F &>()())> Async(F job)
+    {
+        typedef decltype(std::declval<F &>()()) Result;
+        std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(job);
+        std::future<Result> result = task->get_future();
+        Submit([task]() { (*task)(); });
+        return result;
+    }
+
+    // runs job(i) for every i in [0, count) and returns once all of them finished. Workers claim the
+    // next index as they become free, so uneven jobs balance out. The calling thread works through
+    // the jobs too, so this can't deadlock when it is a pool worker itself and the other workers are
+    // busy; helpers that start late find nothing left to do.
+    void ParallelFor(int count, std::function<void(int)> job)
+    {
+        if (count < 2)
+        {
+            for (int i = 0; i < count; i++)
+                job(i);
+            return;
+        }
+        std::shared_ptr<ParallelJobs> jobs = std::make_shared<ParallelJobs>(count, std::move(job));
+        unsigned int helpers = std::min((unsigned int)count - 1, Size());
+        for (unsigned int i = 0; i < helpers; i++)
+            Submit([jobs]() { jobs->Run(); });
+        jobs->Run();
+        std::unique_lock<std::mutex> lock(jobs->mutex);
+        jobs->finished.wait(lock, [&jobs]() { return jobs->done == jobs->count; });
+    }
+
+    // blocks until every queued job has finished
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return jobs.empty() && busy == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping;
+    unsigned int busy;
+
+    // shared with the helper jobs of ParallelFor, which may outlive the call that queued them
+    struct ParallelJobs {
+        int count;
+        std::function<void(int)> job;
+        std::atomic<int> next;
+        int done;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        ParallelJobs(int count, std::function<void(int)> job) : count(count), job(std::move(job)), next(0), done(0)
+        {
+        }
+
+        void Run()
+        {
+            for (int i = next++; i < count; i = next++)
+            {
+                job(i);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++done == count)
+                    finished.notify_all();
+            }
+        }
+    };
+
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                busy++;
+            }
+            job();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+                if (jobs.empty() && busy == 0)
+                    idle.notify_all();
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,168 @@
+#ifndef TRANSPARENT_SORTER_H
+#define TRANSPARENT_SORTER_H
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSPARENT_SORTER_SSE2
+#endif
+
+// Back to front order of transparent items that is kept from frame to frame. Every Sort computes
+// the view depth of all items (four at a time with SSE2) and repairs last frame's order with an
+// insertion sort; while the camera and the items move smoothly only a few neighbours swap, so that
+// is close to linear. When the repair has to move too much (a camera cut, items added or removed,
+// or Invalidate was called) the order is rebuilt with an LSD radix sort on the float depths.
+// Nothing is allocated once the buffers grew to the item count.
+class TransparentSorter {
+public:
+    // the insertion sort gives up after this many element moves per item and radix sorts instead
+    static const unsigned int MAX_MOVES_PER_ITEM = 8;
+
+    TransparentSorter() : rebuild(true)
+    {
+    }
+
+    // returns the indices into 'positions' ordered back to front for 'view'. The result stays valid
+    // until the next call.
+    const std::vector<unsigned int> &Sort(const glm::vec3 *positions, unsigned int count, const glm::mat4 &view)
+    {
+        computeDepths(positions, count, view);
+        if (rebuild || order.size() != count || !repairOrder())
+            radixSort();
+        rebuild = false;
+        return order;
+    }
+
+    // forces a full sort next frame, e.g. after the camera jumped or the items were replaced
+    void Invalidate()
+    {
+        rebuild = true;
+    }
+
+    const std::vector<unsigned int> &Order() const
+    {
+        return order;
+    }
+
+private:
+    // view space z per item; it is negative in front of the camera, so ascending is back to front
+    std::vector<float> depths;
+    // item indices back to front and their depths in the same order
+    std::vector<unsigned int> order;
+    std::vector<float> sortedDepths;
+    // radix sort keys and ping-pong buffers
+    std::vector<unsigned int> keys, keysTemp, orderTemp;
+    bool rebuild;
+
+    // z = dot(third row of view, (position, 1)) for every item
+    void computeDepths(const glm::vec3 *positions, unsigned int count, const glm::mat4 &view)
+    {
+        depths.resize(count);
+        const float rx = view[0][2], ry = view[1][2], rz = view[2][2], rw = view[3][2];
+        unsigned int i = 0;
+#ifdef TRANSPARENT_SORTER_SSE2
+        static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "positions must be tightly packed");
+        const float *p = reinterpret_cast<const float *>(positions);
+        const __m128 row0 = _mm_set1_ps(rx), row1 = _mm_set1_ps(ry), row2 = _mm_set1_ps(rz), row3 = _mm_set1_ps(rw);
+        for (; i + 4 <= count; i += 4)
+        {
+            // four positions are three registers: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+            __m128 a = _mm_loadu_ps(p + i * 3);
+            __m128 b = _mm_loadu_ps(p + i * 3 + 4);
+            __m128 c = _mm_loadu_ps(p + i * 3 + 8);
+            __m128 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); // x2 y2 x3 y3
+            __m128 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1)); // y0 z0 y1 z1
+            __m128 x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+            __m128 y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128 z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+            __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, row0), _mm_mul_ps(y, row1)), _mm_add_ps(_mm_mul_ps(z, row2), row3));
+            _mm_storeu_ps(&depths[i], depth);
+        }
+#endif
+        for (; i < count; i++)
+            depths[i] = positions[i].x * rx + positions[i].y * ry + positions[i].z * rz + rw;
+    }
+
+    // insertion sort of last frame's order on the new depths; false if it moved too much
+    bool repairOrder()
+    {
+        unsigned int count = (unsigned int)order.size();
+        for (unsigned int i = 0; i < count; i++)
+            sortedDepths[i] = depths[order[i]];
+        size_t budget = (size_t)count * MAX_MOVES_PER_ITEM;
+        for (unsigned int i = 1; i < count; i++)
+        {
+            float depth = sortedDepths[i];
+            if (!(depth < sortedDepths[i - 1]))
+                continue;
+            unsigned int index = order[i];
+            unsigned int j = i;
+            do
+            {
+                sortedDepths[j] = sortedDepths[j - 1];
+                order[j] = order[j - 1];
+                j--;
+            } while (j > 0 && depth < sortedDepths[j - 1]);
+            sortedDepths[j] = depth;
+            order[j] = index;
+            size_t moves = i - j;
+            if (moves > budget)
+                return false;
+            budget -= moves;
+        }
+        return true;
+    }
+
+    // stable LSD radix sort of all items, 3 passes of 11 bits over the depths mapped to unsigned
+    // integers that compare like the floats. The histograms of all passes are counted up front, and
+    // a pass whose digit is the same for every item (usually the exponent bits) is skipped.
+    void radixSort()
+    {
+        unsigned int count = (unsigned int)depths.size();
+        order.resize(count);
+        sortedDepths.resize(count);
+        keys.resize(count);
+        keysTemp.resize(count);
+        orderTemp.resize(count);
+        unsigned int histograms[3][2048] = {};
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unsigned int bits;
+            std::memcpy(&bits, &depths[i], sizeof(bits));
+            // negative floats flip entirely, positive ones only get the sign bit set
+            unsigned int key = bits ^ ((bits >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+            keys[i] = key;
+            order[i] = i;
+            histograms[0][key & 2047]++;
+            histograms[1][(key >> 11) & 2047]++;
+            histograms[2][key >> 22]++;
+        }
+        for (unsigned int pass = 0; pass < 3; pass++)
+        {
+            unsigned int shift = pass * 11;
+            unsigned int *histogram = histograms[pass];
+            if (count == 0 || histogram[(keys[0] >> shift) & 2047] == count)
+                continue;
+            unsigned int sum = 0;
+            for (unsigned int bucket = 0; bucket < 2048; bucket++)
+            {
+                unsigned int size = histogram[bucket];
+                histogram[bucket] = sum;
+                sum += size;
+            }
+            for (unsigned int i = 0; i < count; i++)
+            {
+                unsigned int destination = histogram[(keys[i] >> shift) & 2047]++;
+                keysTemp[destination] = keys[i];
+                orderTemp[destination] = order[i];
+            }
+            keys.swap(keysTemp);
+            order.swap(orderTemp);
+        }
+    }
+};
+#endif
@@ -0,0 +1,145 @@
+#ifndef WEIGHTED_OIT_H
+#define WEIGHTED_OIT_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <learnopengl/material.h>
+#include <learnopengl/shader.h>
+
+#include <iostream>
+
+// Weighted blended order-independent transparency (McGuire and Bavoil 2013). Transparent surfaces
+// are drawn unsorted, in any batches, into two off-screen targets and resolved in one composite pass:
+// - accumulation (RGBA16F): sum of premultiplied colour * weight in rgb, sum of alpha * weight in a
+// - revealage (R16F): sum of -ln(1 - alpha), so exp(-sum) is the product of all (1 - alpha)
+// The weight falls off with depth, so nearer surfaces dominate the average colour. GL 3.3 has no
+// per-target blend functions; storing the revealage as a sum lets both targets use additive blending.
+// Transparent fragment shaders write through writeTransparent() of weighted_oit.glsl, see transparent.fs.
+class WeightedBlendedOIT {
+public:
+    WeightedBlendedOIT(int width, int height)
+        : composite("shader/oit_composite.vs", "shader/oit_composite.fs"), FBO(0), accumulation(0), revealage(0), depth(0), width(0), height(0)
+    {
+        glGenVertexArrays(1, &emptyVAO);
+        Resize(width, height);
+    }
+
+    WeightedBlendedOIT(const WeightedBlendedOIT &) = delete;
+    WeightedBlendedOIT &operator=(const WeightedBlendedOIT &) = delete;
+
+    // recreates the targets for a new framebuffer size; nothing happens if the size didn't change
+    void Resize(int newWidth, int newHeight)
+    {
+        if ((newWidth == width && newHeight == height) || newWidth <= 0 || newHeight <= 0)
+            return;
+        deleteTargets();
+        width = newWidth;
+        height = newHeight;
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        accumulation = createTarget(GL_RGBA16F, GL_RGBA);
+        revealage = createTarget(GL_R16F, GL_RED);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage, 0);
+        // opaque depth is copied in by Begin, so transparent surfaces behind opaque ones are rejected
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+        const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::WEIGHTED_OIT::FRAMEBUFFER_INCOMPLETE: " << width << "x" << height << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // starts the transparent pass after the opaque one was drawn into 'framebuffer' (0 is the default
+    // one). Its depth is copied with a blit, so it has to be GL_DEPTH24_STENCIL8 like the default
+    // framebuffer usually is. Transparent draws that follow are depth tested but don't write depth.
+    void Begin(GLuint framebuffer = 0)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+        const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClearBufferfv(GL_COLOR, 1, zero);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+    }
+
+    // resolves the transparent surfaces over the opaque image in 'framebuffer' and restores the
+    // default state (depth writes on, blending off)
+    void End(GLuint framebuffer = 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDisable(GL_DEPTH_TEST);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        composite.use();
+        glActiveTexture(GL_TEXTURE0 + composite.samplerUnit("accumulation"));
+        glBindTexture(GL_TEXTURE_2D, accumulation);
+        glActiveTexture(GL_TEXTURE0 + composite.samplerUnit("revealage"));
+        glBindTexture(GL_TEXTURE_2D, revealage);
+        glActiveTexture(GL_TEXTURE0);
+        Material::InvalidateBindings();
+        // one triangle over the whole screen, positions come from gl_VertexID
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+    }
+
+    void Release()
+    {
+        deleteTargets();
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(composite.ID);
+        emptyVAO = 0;
+    }
+
+private:
+    Shader composite;
+    unsigned int FBO;
+    unsigned int accumulation;
+    unsigned int revealage;
+    unsigned int depth;
+    unsigned int emptyVAO;
+    int width, height;
+
+    // a float colour target, sampled with texelFetch by the composite pass
+    unsigned int createTarget(GLenum internalFormat, GLenum format)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_HALF_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        Material::InvalidateBindings();
+        return texture;
+    }
+
+    void deleteTargets()
+    {
+        if (FBO)
+        {
+            glDeleteFramebuffers(1, &FBO);
+            glDeleteTextures(1, &accumulation);
+            glDeleteTextures(1, &revealage);
+            glDeleteRenderbuffers(1, &depth);
+        }
+        FBO = accumulation = revealage = depth = 0;
+        width = height = 0;
+    }
+};
+#endif
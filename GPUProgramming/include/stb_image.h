@@ -363,6 +363,16 @@ RECENT REVISION HISTORY:
 //    huge block of memory and spend disproportionate time decoding it. By
 //    default this is set to (1 << 24), which is 16777216, but that's still
 //    very big.
+//
+//  - If you define STBI_PARALLEL_FOR(count, job, context), the JPEG decoder
+//    spreads a single large image over several threads. It must call
+//    job(context, i) once for every i in [0, count), in any order and on any
+//    thread, and return only once all of them finished. Jobs never allocate
+//    and never call back into stb_image. Baseline scans with restart markers
+//    decode their intervals in parallel (memory sources only), progressive
+//    images run the IDCT in parallel bands of blocks, and resampling and
+//    colour conversion run in parallel bands of rows for every JPEG. The
+//    output is identical to the single threaded decoder.
 
 #ifndef STBI_NO_STDIO
 #include <stdio.h>
@@ -685,6 +695,15 @@ typedef unsigned char validate_uint32[sizeof(stbi__uint32) == 4 ? 1 : -1];
 #define STBI_REALLOC_SIZED(p,oldsz,newsz) STBI_REALLOC(p,newsz)
 #endif
 
+// upper bound on the jobs one parallel step is split into; with the serial fallback
+// everything runs as one job, exactly like the stock decoder
+#ifdef STBI_PARALLEL_FOR
+#define STBI__PARALLEL_JOBS 64
+#else
+#define STBI__PARALLEL_JOBS 1
+#define STBI_PARALLEL_FOR(count, job, context) stbi__parallel_for_serial(count, job, context)
+#endif
+
 // x86/x64 detection
 #if defined(__x86_64__) || defined(_M_X64)
 #define STBI__X64_TARGET
@@ -771,6 +790,37 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels are compiled regardless of the target flags and picked at runtime; define
+// STBI_NO_AVX2 to leave them out
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2) && ((defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__GNUC__) || defined(__clang__))
+#define STBI_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define STBI__AVX2_TARGET
+#else
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)
+static int stbi__avx2_available(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    // the OS must save the ymm registers too (OSXSAVE, then XCR0 bits 1 and 2)
+    __cpuid(info, 1);
+    if (!((info[2] >> 27) & 1) || (_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+#else
+    // also checks that the OS saves the ymm registers
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -2925,10 +2975,144 @@ static void stbi__jpeg_reset(stbi__jpeg* j)
     // since we don't even allow 1<<30 pixels
 }
 
+typedef void (*stbi__parallel_job)(void* context, int index);
+
+#if STBI__PARALLEL_JOBS == 1
+static void stbi__parallel_for_serial(int count, stbi__parallel_job job, void* context)
+{
+    int i;
+    for (i = 0; i < count; ++i)
+        job(context, i);
+}
+#endif
+
+// decode baseline MCU number 'mcu' of the current scan straight into the component planes
+static int stbi__jpeg_decode_mcu(stbi__jpeg* z, int mcu)
+{
+    int k, x, y;
+    STBI_SIMD_ALIGN(short, data[64]);
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        int w = (z->img_comp[n].x + 7) >> 3;
+        int i = mcu % w, j = mcu / w;
+        int ha = z->img_comp[n].ha;
+        if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+        z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
+        return 1;
+    }
+    for (k = 0; k < z->scan_n; ++k) {
+        int n = z->order[k];
+        for (y = 0; y < z->img_comp[n].v; ++y) {
+            for (x = 0; x < z->img_comp[n].h; ++x) {
+                int x2 = ((mcu % z->img_mcu_x) * z->img_comp[n].h + x) * 8;
+                int y2 = ((mcu / z->img_mcu_x) * z->img_comp[n].v + y) * 8;
+                int ha = z->img_comp[n].ha;
+                if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 + x2, z->img_comp[n].w2, data);
+            }
+        }
+    }
+    return 1;
+}
+
+typedef struct
+{
+    stbi__jpeg* z;
+    stbi_uc* scan;      // entropy coded data of the scan
+    int* offsets;       // interval k starts at scan + offsets[k], the scan ends at offsets[intervals]
+    int intervals, mcus;
+    int per_job;        // intervals per job
+    int ok[STBI__PARALLEL_JOBS];
+} stbi__jpeg_interval_jobs;
+
+// every restart interval starts with fresh dc predictions and a byte aligned bit stream, so each
+// one decodes on its own; a job works on a private copy of the decoder state
+static void stbi__jpeg_decode_intervals(void* context, int index)
+{
+    stbi__jpeg_interval_jobs* jobs = (stbi__jpeg_interval_jobs*)context;
+    stbi__jpeg z;
+    stbi__context s;
+    int k, m;
+    int first = index * jobs->per_job;
+    int last = first + jobs->per_job < jobs->intervals ? first + jobs->per_job : jobs->intervals;
+    memcpy(&z, jobs->z, sizeof(z));
+    z.s = &s;
+    jobs->ok[index] = 1;
+    for (k = first; k < last; ++k) {
+        int start = k * z.restart_interval;
+        int end = start + z.restart_interval < jobs->mcus ? start + z.restart_interval : jobs->mcus;
+        stbi__start_mem(&s, jobs->scan + jobs->offsets[k], jobs->offsets[k + 1] - jobs->offsets[k]);
+        stbi__jpeg_reset(&z);
+        for (m = start; m < end; ++m) {
+            if (!stbi__jpeg_decode_mcu(&z, m)) {
+                jobs->ok[index] = 0;
+                return;
+            }
+        }
+    }
+}
+
+// decode a baseline scan with restart markers one interval per job. returns -1 if the scan can't
+// be split (serial build, callback source, markers that don't match the interval count), the
+// caller then decodes it serially
+static int stbi__jpeg_parse_intervals(stbi__jpeg* z)
+{
+    stbi__jpeg_interval_jobs jobs;
+    stbi_uc* p, * end;
+    int i, count;
+    if (STBI__PARALLEL_JOBS == 1 || !z->restart_interval || z->s->read_from_callbacks) return -1;
+
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        jobs.mcus = ((z->img_comp[n].x + 7) >> 3) * ((z->img_comp[n].y + 7) >> 3);
+    }
+    else
+        jobs.mcus = z->img_mcu_x * z->img_mcu_y;
+    jobs.intervals = (jobs.mcus + z->restart_interval - 1) / z->restart_interval;
+    if (jobs.intervals < 2) return -1;
+    jobs.offsets = (int*)stbi__malloc_mad2(jobs.intervals + 1, sizeof(int), 0);
+    if (!jobs.offsets) return stbi__err("outofmem", "Out of memory");
+
+    // find the restart markers; stuffed 0xff00 and 0xff fill bytes aren't markers
+    jobs.z = z;
+    jobs.scan = p = z->s->img_buffer;
+    end = z->s->img_buffer_end;
+    jobs.offsets[0] = 0;
+    i = 1;
+    while (p + 1 < end) {
+        if (p[0] != 0xff || p[1] == 0xff) { ++p; continue; }
+        if (p[1] == 0x00) { p += 2; continue; }
+        if (!STBI__RESTART(p[1])) break;
+        if (i < jobs.intervals) jobs.offsets[i] = (int)(p + 2 - jobs.scan);
+        ++i;
+        p += 2;
+    }
+    if (p + 1 >= end) p = end;
+    if (i != jobs.intervals) {
+        STBI_FREE(jobs.offsets);
+        return -1;
+    }
+    jobs.offsets[jobs.intervals] = (int)(p - jobs.scan);
+
+    jobs.per_job = (jobs.intervals + STBI__PARALLEL_JOBS - 1) / STBI__PARALLEL_JOBS;
+    count = (jobs.intervals + jobs.per_job - 1) / jobs.per_job;
+    STBI_PARALLEL_FOR(count, stbi__jpeg_decode_intervals, &jobs);
+    STBI_FREE(jobs.offsets);
+    for (i = 0; i < count; ++i)
+        if (!jobs.ok[i]) return stbi__err("bad huffman code", "Corrupt JPEG");
+
+    // continue after the scan as if it had been read serially
+    z->s->img_buffer = p;
+    stbi__jpeg_reset(z);
+    return 1;
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg* z)
 {
     stbi__jpeg_reset(z);
     if (!z->progressive) {
+        int parallel = stbi__jpeg_parse_intervals(z);
+        if (parallel >= 0) return parallel;
         if (z->scan_n == 1) {
             int i, j;
             STBI_SIMD_ALIGN(short, data[64]);
@@ -3060,25 +3244,47 @@ static void stbi__jpeg_dequantize(short* data, stbi__uint16* dequant)
         data[i] *= dequant[i];
 }
 
-static void stbi__jpeg_finish(stbi__jpeg* z)
+typedef struct
 {
-    if (z->progressive) {
-        // dequantize and idct the data
-        int i, j, n;
-        for (n = 0; n < z->s->img_n; ++n) {
-            int w = (z->img_comp[n].x + 7) >> 3;
-            int h = (z->img_comp[n].y + 7) >> 3;
-            for (j = 0; j < h; ++j) {
-                for (i = 0; i < w; ++i) {
-                    short* data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-                    stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
-                }
+    stbi__jpeg* z;
+    int per_job; // block rows per job, counted over all components
+} stbi__jpeg_finish_jobs;
+
+static void stbi__jpeg_finish_rows(void* context, int index)
+{
+    stbi__jpeg_finish_jobs* jobs = (stbi__jpeg_finish_jobs*)context;
+    stbi__jpeg* z = jobs->z;
+    int i, j, n, row = 0;
+    int first = index * jobs->per_job, last = first + jobs->per_job;
+    for (n = 0; n < z->s->img_n; ++n) {
+        int w = (z->img_comp[n].x + 7) >> 3;
+        int h = (z->img_comp[n].y + 7) >> 3;
+        for (j = 0; j < h; ++j, ++row) {
+            if (row < first || row >= last) continue;
+            for (i = 0; i < w; ++i) {
+                short* data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+                z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * j * 8 + i * 8, z->img_comp[n].w2, data);
             }
         }
     }
 }
 
+static void stbi__jpeg_finish(stbi__jpeg* z)
+{
+    if (z->progressive) {
+        // dequantize and idct the data, in bands of block rows
+        stbi__jpeg_finish_jobs jobs;
+        int n, rows = 0;
+        for (n = 0; n < z->s->img_n; ++n)
+            rows += (z->img_comp[n].y + 7) >> 3;
+        jobs.z = z;
+        jobs.per_job = (rows + STBI__PARALLEL_JOBS - 1) / STBI__PARALLEL_JOBS;
+        if (jobs.per_job < 1) return;
+        STBI_PARALLEL_FOR((rows + jobs.per_job - 1) / jobs.per_job, stbi__jpeg_finish_rows, &jobs);
+    }
+}
+
 static int stbi__process_marker(stbi__jpeg* z, int m)
 {
     int L;
@@ -3611,6 +3817,62 @@ static stbi_uc* stbi__resample_row_hv_2_simd(stbi_uc* out, stbi_uc* in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// same filter as stbi__resample_row_hv_2_simd, 16 pixels at a time
+STBI__AVX2_TARGET static stbi_uc* stbi__resample_row_hv_2_avx2(stbi_uc* out, stbi_uc* in_near, stbi_uc* in_far, int w, int hs)
+{
+    int i = 0, t0, t1;
+
+    if (w == 1) {
+        out[0] = out[1] = stbi__div4(3 * in_near[0] + in_far[0] + 2);
+        return out;
+    }
+
+    t1 = 3 * in_near[0] + in_far[0];
+    for (; i < ((w - 1) & ~15); i += 16) {
+        // vertical pass, 3*x + y = 4*x + (y - x)
+        __m256i farw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (in_far + i)));
+        __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (in_near + i)));
+        __m256i curr = _mm256_add_epi16(_mm256_slli_epi16(nearw, 2), _mm256_sub_epi16(farw, nearw));
+
+        // shift the row by one pixel either way; alignr works per 128 bit lane, so the lane
+        // crossing word comes from a permuted copy
+        __m256i lower = _mm256_permute2x128_si256(curr, curr, 0x08);
+        __m256i upper = _mm256_permute2x128_si256(curr, curr, 0x81);
+        __m256i prev = _mm256_insert_epi16(_mm256_alignr_epi8(curr, lower, 14), t1, 0);
+        __m256i next = _mm256_insert_epi16(_mm256_alignr_epi8(upper, curr, 2), 3 * in_near[i + 16] + in_far[i + 16], 15);
+
+        // even pixels = cur*4 + (prev - cur), odd pixels = cur*4 + (next - cur)
+        __m256i curb = _mm256_add_epi16(_mm256_slli_epi16(curr, 2), _mm256_set1_epi16(8));
+        __m256i even = _mm256_add_epi16(_mm256_sub_epi16(prev, curr), curb);
+        __m256i odd = _mm256_add_epi16(_mm256_sub_epi16(next, curr), curb);
+
+        // interleaving within the lanes and packing keeps the pixels in order
+        __m256i de0 = _mm256_srli_epi16(_mm256_unpacklo_epi16(even, odd), 4);
+        __m256i de1 = _mm256_srli_epi16(_mm256_unpackhi_epi16(even, odd), 4);
+        _mm256_storeu_si256((__m256i*) (out + i * 2), _mm256_packus_epi16(de0, de1));
+
+        t1 = 3 * in_near[i + 15] + in_far[i + 15];
+    }
+
+    t0 = t1;
+    t1 = 3 * in_near[i] + in_far[i];
+    out[i * 2] = stbi__div16(3 * t1 + t0 + 8);
+
+    for (++i; i < w; ++i) {
+        t0 = t1;
+        t1 = 3 * in_near[i] + in_far[i];
+        out[i * 2 - 1] = stbi__div16(3 * t0 + t1 + 8);
+        out[i * 2] = stbi__div16(3 * t1 + t0 + 8);
+    }
+    out[w * 2 - 1] = stbi__div4(t1 + 2);
+
+    STBI_NOTUSED(hs);
+
+    return out;
+}
+#endif
+
 static stbi_uc* stbi__resample_row_generic(stbi_uc* out, stbi_uc* in_near, stbi_uc* in_far, int w, int hs)
 {
     // resample with nearest-neighbor
@@ -3785,6 +4047,68 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc* out, stbi_uc const* y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// the SSE2 arithmetic on 16 pixels at a time; unlike the SSE2 version this also handles step == 3,
+// the layout stb_image returns for JPEGs by default
+STBI__AVX2_TARGET static void stbi__YCbCr_to_RGB_avx2(stbi_uc* out, stbi_uc const* y, stbi_uc const* pcb, stbi_uc const* pcr, int count, int step)
+{
+    int i = 0;
+    if (step == 3 || step == 4) {
+        __m256i cr_const0 = _mm256_set1_epi16((short)(1.40200f * 4096.0f + 0.5f));
+        __m256i cr_const1 = _mm256_set1_epi16(-(short)(0.71414f * 4096.0f + 0.5f));
+        __m256i cb_const0 = _mm256_set1_epi16(-(short)(0.34414f * 4096.0f + 0.5f));
+        __m256i cb_const1 = _mm256_set1_epi16((short)(1.77200f * 4096.0f + 0.5f));
+        __m256i bias = _mm256_set1_epi16(128);
+        __m256i xw = _mm256_set1_epi16(255); // alpha channel
+        // drops every fourth byte of 4 pixels, the 3 channel output is stored 12 bytes apart
+        __m256i rgb = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                       0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+        // with step 3 every store writes 4 bytes past its pixels, so stop 2 pixels early
+        for (; i + 15 + (step == 3 ? 2 : 0) < count; i += 16) {
+            // widen to 16 bit: y * 16 + 8 and (c - 128) << 8, like the SSE2 unpacks
+            __m256i yw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (y + i)));
+            __m256i crw = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (pcr + i))), bias), 8);
+            __m256i cbw = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*) (pcb + i))), bias), 8);
+            __m256i yws = _mm256_add_epi16(_mm256_slli_epi16(yw, 4), _mm256_set1_epi16(8));
+
+            // color transform
+            __m256i rws = _mm256_add_epi16(_mm256_mulhi_epi16(cr_const0, crw), yws);
+            __m256i gws = _mm256_add_epi16(_mm256_add_epi16(_mm256_mulhi_epi16(cb_const0, cbw), yws), _mm256_mulhi_epi16(crw, cr_const1));
+            __m256i bws = _mm256_add_epi16(yws, _mm256_mulhi_epi16(cbw, cb_const1));
+
+            // descale, back to byte and interleave; per lane this gives pixels 0-3 and 8-11 in o0,
+            // 4-7 and 12-15 in o1
+            __m256i brb = _mm256_packus_epi16(_mm256_srai_epi16(rws, 4), _mm256_srai_epi16(bws, 4));
+            __m256i gxb = _mm256_packus_epi16(_mm256_srai_epi16(gws, 4), xw);
+            __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+            __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+            __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+            __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+            if (step == 4) {
+                _mm256_storeu_si256((__m256i*) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+                _mm256_storeu_si256((__m256i*) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+                out += 64;
+            }
+            else {
+                o0 = _mm256_shuffle_epi8(o0, rgb);
+                o1 = _mm256_shuffle_epi8(o1, rgb);
+                _mm_storeu_si128((__m128i*) (out + 0), _mm256_castsi256_si128(o0));
+                _mm_storeu_si128((__m128i*) (out + 12), _mm256_castsi256_si128(o1));
+                _mm_storeu_si128((__m128i*) (out + 24), _mm256_extracti128_si256(o0, 1));
+                _mm_storeu_si128((__m128i*) (out + 36), _mm256_extracti128_si256(o1, 1));
+                out += 48;
+            }
+        }
+    }
+
+    // the rest through the SSE2 and scalar code
+    if (i < count)
+        stbi__YCbCr_to_RGB_simd(out, y + i, pcb + i, pcr + i, count - i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg* j)
 {
@@ -3800,6 +4124,13 @@ static void stbi__setup_jpeg(stbi__jpeg* j)
     }
 #endif
 
+#ifdef STBI_AVX2
+    if (stbi__avx2_available()) {
+        j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+        j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+    }
+#endif
+
 #ifdef STBI_NEON
     j->idct_block_kernel = stbi__idct_simd;
     j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -3830,6 +4161,151 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
     return (stbi_uc)((t + (t >> 8)) >> 8);
 }
 
+typedef struct
+{
+    stbi__jpeg* z;
+    stbi__resample res_comp[4]; // resampling state at the first row
+    stbi_uc* output;
+    stbi_uc* last_rows;          // the last row of every job but the final one is converted here
+    int n, decode_n, is_rgb;
+    int per_job;                 // rows per job; job i uses line buffer i of every component
+} stbi__jpeg_output_jobs;
+
+static void stbi__resample_next_row(stbi__resample* r, int y, int w2)
+{
+    if (++r->ystep >= r->vs) {
+        r->ystep = 0;
+        r->line0 = r->line1;
+        if (++r->ypos < y)
+            r->line1 += w2;
+    }
+}
+
+static void stbi__jpeg_output_rows(void* context, int index)
+{
+    stbi__jpeg_output_jobs* jobs = (stbi__jpeg_output_jobs*)context;
+    stbi__jpeg* z = jobs->z;
+    int k, n = jobs->n, decode_n = jobs->decode_n, is_rgb = jobs->is_rgb;
+    unsigned int i, j;
+    unsigned int first = index * jobs->per_job;
+    unsigned int last = first + jobs->per_job < z->s->img_y ? first + jobs->per_job : z->s->img_y;
+    stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
+    stbi_uc* linebuf[4] = { NULL, NULL, NULL, NULL };
+    stbi__resample res_comp[4];
+
+    // bring the vertical resampling state forward to the band's first row
+    for (k = 0; k < decode_n; ++k) {
+        res_comp[k] = jobs->res_comp[k];
+        linebuf[k] = z->img_comp[k].linebuf + (size_t)index * (z->s->img_x + 3);
+        for (j = 0; j < first; ++j)
+            stbi__resample_next_row(&res_comp[k], z->img_comp[k].y, z->img_comp[k].w2);
+    }
+
+    for (j = first; j < last; ++j) {
+        // the colour conversions write one byte past a 3 channel row, into the next job's first row
+        stbi_uc* row = jobs->output + n * z->s->img_x * j;
+        stbi_uc* out = j + 1 == last && last < z->s->img_y ? jobs->last_rows + (size_t)index * (n * z->s->img_x + 1) : row;
+        stbi_uc* converted = out;
+        for (k = 0; k < decode_n; ++k) {
+            stbi__resample* r = &res_comp[k];
+            int y_bot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(linebuf[k],
+                y_bot ? r->line1 : r->line0,
+                y_bot ? r->line0 : r->line1,
+                r->w_lores, r->hs);
+            stbi__resample_next_row(r, z->img_comp[k].y, z->img_comp[k].w2);
+        }
+        if (n >= 3) {
+            stbi_uc* y = coutput[0];
+            if (z->s->img_n == 3) {
+                if (is_rgb) {
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        out[0] = y[i];
+                        out[1] = coutput[1][i];
+                        out[2] = coutput[2][i];
+                        out[3] = 255;
+                        out += n;
+                    }
+                }
+                else {
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                }
+            }
+            else if (z->s->img_n == 4) {
+                if (z->app14_color_transform == 0) { // CMYK
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        stbi_uc m = coutput[3][i];
+                        out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                        out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                        out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                        out[3] = 255;
+                        out += n;
+                    }
+                }
+                else if (z->app14_color_transform == 2) { // YCCK
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        stbi_uc m = coutput[3][i];
+                        out[0] = stbi__blinn_8x8(255 - out[0], m);
+                        out[1] = stbi__blinn_8x8(255 - out[1], m);
+                        out[2] = stbi__blinn_8x8(255 - out[2], m);
+                        out += n;
+                    }
+                }
+                else { // YCbCr + alpha?  Ignore the fourth channel for now
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                }
+            }
+            else
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = out[1] = out[2] = y[i];
+                    out[3] = 255; // not used if n==3
+                    out += n;
+                }
+        }
+        else {
+            if (is_rgb) {
+                if (n == 1)
+                    for (i = 0; i < z->s->img_x; ++i)
+                        *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                else {
+                    for (i = 0; i < z->s->img_x; ++i, out += 2) {
+                        out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                        out[1] = 255;
+                    }
+                }
+            }
+            else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+                for (i = 0; i < z->s->img_x; ++i) {
+                    stbi_uc m = coutput[3][i];
+                    stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+                    stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+                    stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+                    out[0] = stbi__compute_y(r, g, b);
+                    out[1] = 255;
+                    out += n;
+                }
+            }
+            else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+                    out[1] = 255;
+                    out += n;
+                }
+            }
+            else {
+                stbi_uc* y = coutput[0];
+                if (n == 1)
+                    for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
+                else
+                    for (i = 0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+            }
+        }
+        if (converted != row)
+            memcpy(row, converted, n * z->s->img_x);
+    }
+}
+
 static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp, int req_comp)
 {
     int n, decode_n, is_rgb;
@@ -3857,19 +4333,20 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
 
     // resample and color-convert
     {
-        int k;
-        unsigned int i, j;
+        int k, count;
         stbi_uc* output;
-        stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
+        stbi__jpeg_output_jobs jobs;
 
-        stbi__resample res_comp[4];
+        jobs.per_job = (z->s->img_y + STBI__PARALLEL_JOBS - 1) / STBI__PARALLEL_JOBS;
+        if (jobs.per_job < 16) jobs.per_job = 16;
+        count = (z->s->img_y + jobs.per_job - 1) / jobs.per_job;
 
         for (k = 0; k < decode_n; ++k) {
-            stbi__resample* r = &res_comp[k];
+            stbi__resample* r = &jobs.res_comp[k];
 
             // allocate line buffer big enough for upsampling off the edges
-            // with upsample factor of 4
-            z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc(z->s->img_x + 3);
+            // with upsample factor of 4, one per job
+            z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc_mad2(z->s->img_x + 3, count, 0);
             if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
             r->hs = z->img_h_max / z->img_comp[k].h;
@@ -3886,114 +4363,23 @@ static stbi_uc* load_jpeg_image(stbi__jpeg* z, int* out_x, int* out_y, int* comp
             else                               r->resample = stbi__resample_row_generic;
         }
 
-        // can't error after this so, this is safe
         output = (stbi_uc*)stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
         if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
-        // now go ahead and resample
-        for (j = 0; j < z->s->img_y; ++j) {
-            stbi_uc* out = output + n * z->s->img_x * j;
-            for (k = 0; k < decode_n; ++k) {
-                stbi__resample* r = &res_comp[k];
-                int y_bot = r->ystep >= (r->vs >> 1);
-                coutput[k] = r->resample(z->img_comp[k].linebuf,
-                    y_bot ? r->line1 : r->line0,
-                    y_bot ? r->line0 : r->line1,
-                    r->w_lores, r->hs);
-                if (++r->ystep >= r->vs) {
-                    r->ystep = 0;
-                    r->line0 = r->line1;
-                    if (++r->ypos < z->img_comp[k].y)
-                        r->line1 += z->img_comp[k].w2;
-                }
-            }
-            if (n >= 3) {
-                stbi_uc* y = coutput[0];
-                if (z->s->img_n == 3) {
-                    if (is_rgb) {
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            out[0] = y[i];
-                            out[1] = coutput[1][i];
-                            out[2] = coutput[2][i];
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else {
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else if (z->s->img_n == 4) {
-                    if (z->app14_color_transform == 0) { // CMYK
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            stbi_uc m = coutput[3][i];
-                            out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                            out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                            out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else if (z->app14_color_transform == 2) { // YCCK
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            stbi_uc m = coutput[3][i];
-                            out[0] = stbi__blinn_8x8(255 - out[0], m);
-                            out[1] = stbi__blinn_8x8(255 - out[1], m);
-                            out[2] = stbi__blinn_8x8(255 - out[2], m);
-                            out += n;
-                        }
-                    }
-                    else { // YCbCr + alpha?  Ignore the fourth channel for now
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = out[1] = out[2] = y[i];
-                        out[3] = 255; // not used if n==3
-                        out += n;
-                    }
-            }
-            else {
-                if (is_rgb) {
-                    if (n == 1)
-                        for (i = 0; i < z->s->img_x; ++i)
-                            *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                    else {
-                        for (i = 0; i < z->s->img_x; ++i, out += 2) {
-                            out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                            out[1] = 255;
-                        }
-                    }
-                }
-                else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        stbi_uc m = coutput[3][i];
-                        stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                        stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                        stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                        out[0] = stbi__compute_y(r, g, b);
-                        out[1] = 255;
-                        out += n;
-                    }
-                }
-                else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                        out[1] = 255;
-                        out += n;
-                    }
-                }
-                else {
-                    stbi_uc* y = coutput[0];
-                    if (n == 1)
-                        for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
-                    else
-                        for (i = 0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-                }
-            }
+        jobs.last_rows = NULL;
+        if (count > 1) {
+            jobs.last_rows = (stbi_uc*)stbi__malloc_mad3(n, z->s->img_x, count, count);
+            if (!jobs.last_rows) { STBI_FREE(output); stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
         }
+
+        // resample and color-convert in bands of rows
+        jobs.z = z;
+        jobs.output = output;
+        jobs.n = n;
+        jobs.decode_n = decode_n;
+        jobs.is_rgb = is_rgb;
+        STBI_PARALLEL_FOR(count, stbi__jpeg_output_rows, &jobs);
+        STBI_FREE(jobs.last_rows);
         stbi__cleanup_jpeg(z);
         *out_x = z->s->img_x;
         *out_y = z->s->img_y;
@@ -4632,6 +5018,116 @@ static int stbi__paeth(int a, int b, int c)
 
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// SIMD filter reconstruction. Up is independent per byte and runs 16 (SSE2) or 32 (AVX2) bytes at
+// a time; Sub, Avg and Paeth depend on the pixel to the left, so they run one 3 or 4 byte pixel
+// per vector, all channels at once.
+static stbi_inline __m128i stbi__png_load_pixel(stbi_uc const* p, int n)
+{
+    stbi__uint32 v = 0;
+    memcpy(&v, p, n);
+    return _mm_cvtsi32_si128((int)v);
+}
+
+static stbi_inline void stbi__png_store_pixel(stbi_uc* p, __m128i v, int n)
+{
+    stbi__uint32 x = (stbi__uint32)_mm_cvtsi128_si32(v);
+    memcpy(p, &x, n);
+}
+
+static stbi_inline __m128i stbi__png_abs16(__m128i x)
+{
+    __m128i negative = _mm_cmplt_epi16(x, _mm_setzero_si128());
+    return _mm_sub_epi16(_mm_xor_si128(x, negative), negative);
+}
+
+static stbi_inline __m128i stbi__png_select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// 'count' pixels of 'n' bytes; cur[-n] and prior[-n] hold the already reconstructed pixels to the left
+static stbi_inline void stbi__png_unfilter_pixels(int filter, stbi_uc* cur, stbi_uc const* prior, stbi_uc const* raw, int count, int n)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i a = stbi__png_load_pixel(cur - n, n);
+    int i;
+    if (filter == STBI__F_sub) {
+        for (i = 0; i < count; ++i, cur += n, raw += n) {
+            a = _mm_add_epi8(a, stbi__png_load_pixel(raw, n));
+            stbi__png_store_pixel(cur, a, n);
+        }
+    }
+    else if (filter == STBI__F_avg) {
+        // PNG truncates the average while _mm_avg_epu8 rounds up, so take the rounding bit back off
+        __m128i one = _mm_set1_epi8(1);
+        for (i = 0; i < count; ++i, cur += n, prior += n, raw += n) {
+            __m128i b = stbi__png_load_pixel(prior, n);
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(stbi__png_load_pixel(raw, n), avg);
+            stbi__png_store_pixel(cur, a, n);
+        }
+    }
+    else {
+        // in 16 bit so p - c = (b - c) + (a - c) can't overflow; ties favour a, then b, then c
+        __m128i b = _mm_unpacklo_epi8(stbi__png_load_pixel(prior - n, n), zero);
+        a = _mm_unpacklo_epi8(a, zero);
+        for (i = 0; i < count; ++i, cur += n, prior += n, raw += n) {
+            __m128i c = b, pa, pb, pc, smallest, nearest;
+            b = _mm_unpacklo_epi8(stbi__png_load_pixel(prior, n), zero);
+            pa = _mm_sub_epi16(b, c);
+            pb = _mm_sub_epi16(a, c);
+            pc = stbi__png_abs16(_mm_add_epi16(pa, pb));
+            pa = stbi__png_abs16(pa);
+            pb = stbi__png_abs16(pb);
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            nearest = stbi__png_select(_mm_cmpeq_epi16(smallest, pa), a,
+                      stbi__png_select(_mm_cmpeq_epi16(smallest, pb), b, c));
+            // byte adds wrap modulo 256 and leave the zero high bytes alone
+            a = _mm_add_epi8(_mm_unpacklo_epi8(stbi__png_load_pixel(raw, n), zero), nearest);
+            stbi__png_store_pixel(cur, _mm_packus_epi16(a, a), n);
+        }
+    }
+}
+
+#ifdef STBI_AVX2
+STBI__AVX2_TARGET static int stbi__png_unfilter_up_avx2(stbi_uc* cur, stbi_uc const* prior, stbi_uc const* raw, int count)
+{
+    int k = 0;
+    for (; k + 32 <= count; k += 32)
+        _mm256_storeu_si256((__m256i*) (cur + k), _mm256_add_epi8(_mm256_loadu_si256((__m256i const*) (raw + k)), _mm256_loadu_si256((__m256i const*) (prior + k))));
+    return k;
+}
+#endif
+
+// reconstructs the rest of a row after its first pixel. 'pixel_bytes' is 3 or 4 for 8 bit RGB(A)
+// rows and 0 otherwise, those only get Up. returns 0 if the row is left to the scalar code.
+static int stbi__png_unfilter_simd(int filter, stbi_uc* cur, stbi_uc const* prior, stbi_uc const* raw, int nk, int pixel_bytes, int avx2)
+{
+    int k = 0;
+    switch (filter) {
+    case STBI__F_up:
+#ifdef STBI_AVX2
+        if (avx2) k = stbi__png_unfilter_up_avx2(cur, prior, raw, nk);
+#endif
+        for (; k + 16 <= nk; k += 16)
+            _mm_storeu_si128((__m128i*) (cur + k), _mm_add_epi8(_mm_loadu_si128((__m128i const*) (raw + k)), _mm_loadu_si128((__m128i const*) (prior + k))));
+        for (; k < nk; ++k)
+            cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+        return 1;
+    case STBI__F_sub:
+    case STBI__F_avg:
+    case STBI__F_paeth:
+        // constant pixel sizes so the loads and stores compile to single moves
+        if (pixel_bytes == 4) { stbi__png_unfilter_pixels(filter, cur, prior, raw, nk / 4, 4); return 1; }
+        if (pixel_bytes == 3) { stbi__png_unfilter_pixels(filter, cur, prior, raw, nk / 3, 3); return 1; }
+        return 0;
+    }
+    STBI_NOTUSED(avx2);
+    return 0;
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png* a, stbi_uc* raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4645,6 +5141,7 @@ static int stbi__create_png_image_raw(stbi__png* a, stbi_uc* raw, stbi__uint32 r
     int output_bytes = out_n * bytes;
     int filter_bytes = img_n * bytes;
     int width = x;
+    int avx2 = 0;
 
     STBI_ASSERT(out_n == s->img_n || out_n == s->img_n + 1);
     a->out = (stbi_uc*)stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
@@ -4659,6 +5156,11 @@ static int stbi__create_png_image_raw(stbi__png* a, stbi_uc* raw, stbi__uint32 r
     // so just check for raw_len < img_len always.
     if (raw_len < img_len) return stbi__err("not enough pixels", "Corrupt PNG");
 
+#ifdef STBI_AVX2
+    avx2 = stbi__avx2_available();
+#endif
+    STBI_NOTUSED(avx2);
+
     for (j = 0; j < y; ++j) {
         stbi_uc* cur = a->out + stride * j;
         stbi_uc* prior;
@@ -4716,10 +5218,14 @@ static int stbi__create_png_image_raw(stbi__png* a, stbi_uc* raw, stbi__uint32 r
         // this is a little gross, so that we don't switch per-pixel or per-component
         if (depth < 8 || img_n == out_n) {
             int nk = (width - 1) * filter_bytes;
+            int simd = 0;
+#ifdef STBI_SSE2
+            simd = stbi__png_unfilter_simd(filter, cur, prior, raw, nk, depth == 8 && (img_n == 3 || img_n == 4) ? img_n : 0, avx2);
+#endif
 #define STBI__CASE(f) \
              case f:     \
                 for (k=0; k < nk; ++k)
-            switch (filter) {
+            if (!simd) switch (filter) {
                 // "none" filter turns into a memcpy here; make that explicit.
             case STBI__F_none:         memcpy(cur, raw, nk); break;
                 STBI__CASE(STBI__F_sub) { cur[k] = STBI__BYTECAST(raw[k] + cur[k - filter_bytes]); } break;
@@ -1,11 +1,9 @@
 #version 330 core
-out vec4 FragColor;
-
-in vec2 TexCoords;
+#include "fragment_common.glsl"
 
 uniform sampler2D texture1;
 
 void main()
 {
     FragColor = vec4(0.04, 0.28, 0.26, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+#version 430 core
+// one invocation per GpuScene instance: frustum and occlusion test, then the visible ones are
+// appended to the draw command of their mesh
+layout (local_size_x = 64) in;
+
+#include "gpu_instances.glsl"
+
+// DrawElementsIndirectCommand; instanceCount is 0 when the dispatch starts
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 1) buffer Commands
+{
+    DrawCommand commands[];
+};
+
+// visible instance indices, the ones of each command start at its baseInstance
+layout (std430, binding = 2) writeonly buffer VisibleInstances
+{
+    uint visible[];
+};
+
+uniform uint instanceCount;
+uniform uint commandCount;
+uniform mat4 viewProjection;
+// the previous frame's depth pyramid (farthest depth per texel) and the camera it was seen with
+uniform bool occlusion;
+uniform mat4 previousViewProjection;
+uniform sampler2D depthPyramid;
+uniform int depthPyramidLevels;
+
+vec4 corner(GpuInstance instance, int i)
+{
+    vec3 position = vec3((i & 1) != 0 ? instance.boundsMax.x : instance.boundsMin.x,
+                         (i & 2) != 0 ? instance.boundsMax.y : instance.boundsMin.y,
+                         (i & 4) != 0 ? instance.boundsMax.z : instance.boundsMin.z);
+    return instance.model * vec4(position, 1.0);
+}
+
+// outside if all eight corners are beyond one of the clip planes
+bool inFrustum(GpuInstance instance)
+{
+    ivec3 below = ivec3(0);
+    ivec3 above = ivec3(0);
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 clip = viewProjection * corner(instance, i);
+        below += ivec3(lessThan(clip.xyz, vec3(-clip.w)));
+        above += ivec3(greaterThan(clip.xyz, vec3(clip.w)));
+    }
+    return all(lessThan(below, ivec3(8))) && all(lessThan(above, ivec3(8)));
+}
+
+// hidden if the box's nearest depth is behind the farthest depth of the pyramid texels covering its
+// screen rectangle, clamped to the screen. Boxes that crossed the near plane or were entirely off
+// screen last frame count as visible.
+bool occluded(GpuInstance instance)
+{
+    vec2 low = vec2(1.0);
+    vec2 high = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 clip = previousViewProjection * corner(instance, i);
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        low = min(low, ndc.xy * 0.5 + 0.5);
+        high = max(high, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    if (any(lessThan(high, vec2(0.0))) || any(greaterThan(low, vec2(1.0))))
+        return false;
+    low = clamp(low, 0.0, 1.0);
+    high = clamp(high, 0.0, 1.0);
+
+    // the level where the rectangle spans at most 2x2 texels, so four fetches cover it
+    // (levels are halved and rounded down, like the pyramid was allocated)
+    ivec2 baseSize = textureSize(depthPyramid, 0);
+    vec2 extent = (high - low) * vec2(baseSize);
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, depthPyramidLevels - 1);
+    ivec2 first, last;
+    for (;; level++)
+    {
+        ivec2 size = max(baseSize >> level, ivec2(1));
+        first = min(ivec2(low * vec2(size)), size - 1);
+        last = min(ivec2(high * vec2(size)), size - 1);
+        if (all(lessThanEqual(last - first, ivec2(1))) || level == depthPyramidLevels - 1)
+            break;
+    }
+    float farthest = max(max(texelFetch(depthPyramid, first, level).r, texelFetch(depthPyramid, ivec2(last.x, first.y), level).r),
+                         max(texelFetch(depthPyramid, ivec2(first.x, last.y), level).r, texelFetch(depthPyramid, last, level).r));
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= instanceCount)
+        return;
+    GpuInstance instance = instances[id];
+    if (instance.command >= commandCount || !inFrustum(instance) || (occlusion && occluded(instance)))
+        return;
+    uint slot = atomicAdd(commands[instance.command].instanceCount, 1u);
+    visible[commands[instance.command].baseInstance + slot] = id;
+}
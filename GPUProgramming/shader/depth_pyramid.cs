@@ -0,0 +1,26 @@
+#version 430 core
+// one level of a GpuScene depth pyramid: every texel keeps the farthest depth of the source texels
+// it covers. Level 0 reads the depth texture at the same size, which makes it a copy. The source
+// size comes from the application: textureSize with a non-constant lod is wrong on some drivers.
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D source;
+uniform int sourceLevel;
+uniform ivec2 sourceSize;
+layout (r32f, binding = 0) uniform writeonly image2D destination;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destination);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+    // with odd source sizes a texel covers three source texels in that direction
+    ivec2 first = texel * sourceSize / size;
+    ivec2 last = max(((texel + 1) * sourceSize + size - 1) / size - 1, first);
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+        for (int x = first.x; x <= last.x; x++)
+            depth = max(depth, texelFetch(source, ivec2(x, y), sourceLevel).r);
+    imageStore(destination, texel, vec4(depth));
+}
@@ -0,0 +1,4 @@
+// outputs and interpolated inputs shared by the surface fragment shaders
+layout (location = 0) out vec4 FragColor;
+
+in vec2 TexCoords;
@@ -0,0 +1,9 @@
+// per-frame camera and time state, filled once per frame by FrameUniforms (frame_uniforms.h)
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 time;
+};
@@ -0,0 +1,16 @@
+// the instances of a GpuScene (gpu_scene.h), same layout as GpuInstance
+struct GpuInstance
+{
+    mat4 model;
+    vec4 boundsMin; // object space bounding box, w unused
+    vec4 boundsMax;
+    uint command;   // draw command of the instance's mesh
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+layout (std430, binding = 0) readonly buffer Instances
+{
+    GpuInstance instances[];
+};
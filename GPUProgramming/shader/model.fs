@@ -0,0 +1,9 @@
+#version 330 core
+#include "fragment_common.glsl"
+
+uniform sampler2D texture_diffuse1;
+
+void main()
+{
+    FragColor = texture(texture_diffuse1, TexCoords);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+#include "frame_data.glsl"
+
+uniform mat4 model;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
+}
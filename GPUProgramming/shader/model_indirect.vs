@@ -0,0 +1,17 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// index of the instance, fed from GpuScene's visible list (GpuScene::INSTANCE_ATTRIBUTE)
+layout (location = 7) in uint aInstance;
+
+out vec2 TexCoords;
+
+#include "frame_data.glsl"
+#include "gpu_instances.glsl"
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * instances[aInstance].model * vec4(aPos, 1.0);
+}
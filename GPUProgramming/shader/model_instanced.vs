@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// per-instance transform, replaces the model uniform (InstanceBuffer::INSTANCE_MATRIX_ATTRIBUTE)
+layout (location = 8) in mat4 aInstanceModel;
+
+out vec2 TexCoords;
+
+#include "frame_data.glsl"
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * aInstanceModel * vec4(aPos, 1.0);
+}
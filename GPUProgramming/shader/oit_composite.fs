@@ -0,0 +1,21 @@
+#version 330 core
+// resolves weighted blended OIT over the opaque image, blended with SRC_ALPHA, ONE_MINUS_SRC_ALPHA
+out vec4 FragColor;
+
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float transmittance = exp(-texelFetch(revealage, texel, 0).r);
+    // nothing transparent was drawn here
+    if (transmittance >= 0.999)
+        discard;
+    vec4 accum = texelFetch(accumulation, texel, 0);
+    // a sum that overflowed half float precision still gives a usable colour
+    if (isinf(max(max(abs(accum.r), abs(accum.g)), max(abs(accum.b), abs(accum.a)))))
+        accum.rgb = vec3(accum.a);
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    FragColor = vec4(average, 1.0 - transmittance);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+#include "fragment_common.glsl"
+#ifdef WEIGHTED_OIT
+#include "weighted_oit.glsl"
+#endif
+
+// tinted glass: a flat colour with alpha, darker towards the edges of the pane
+uniform vec4 color;
+
+void main()
+{
+    vec2 edge = min(TexCoords, 1.0 - TexCoords);
+    float frame = smoothstep(0.0, 0.05, min(edge.x, edge.y));
+    vec4 glass = vec4(color.rgb * mix(0.3, 1.0, frame), mix(1.0, color.a, frame));
+#ifdef WEIGHTED_OIT
+    writeTransparent(glass);
+#else
+    FragColor = glass;
+#endif
+}
@@ -1,12 +1,16 @@
 #version 330 core
-out vec4 FragColor;
+#include "fragment_common.glsl"
 
-in vec2 TexCoords;
+flat in float Layer;
 
-uniform sampler2D texture1;
+uniform sampler2DArray texture1;
 
 void main()
 {             
-    vec4 texColor = texture(texture1, TexCoords);
+    vec4 texColor = texture(texture1, vec3(TexCoords, Layer));
+#ifdef ALPHA_TEST
+    if (texColor.a < 0.1)
+        discard;
+#endif
     FragColor = texColor;
-}
\ No newline at end of file
+}
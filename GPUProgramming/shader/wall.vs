@@ -1,15 +1,18 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in float aLayer;
 
 out vec2 TexCoords;
+flat out float Layer;
+
+#include "frame_data.glsl"
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    Layer = aLayer;
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,14 @@
+// output of transparent surfaces for weighted blended OIT (weighted_oit.h). FragColor is the
+// accumulation target; the revealage target gets the optical depth -ln(1 - alpha), which adds up
+// under additive blending to the product of all (1 - alpha).
+layout (location = 1) out float Revealage;
+
+void writeTransparent(vec4 color)
+{
+    // fully opaque layers would add infinity
+    float alpha = clamp(color.a, 0.0, 0.999);
+    // nearer and more opaque surfaces weigh more (equation 10 of the paper, on window depth)
+    float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    FragColor = vec4(color.rgb * alpha, alpha) * weight;
+    Revealage = -log(1.0 - alpha);
+}
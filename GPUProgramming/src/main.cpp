@@ -1,15 +1,22 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <map>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+// the stb_image implementation is compiled in stb_image.cpp
+#include <learnopengl/image_decoder.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_variants.h>
 #include <learnopengl/camera.h>
+#include <learnopengl/static_batch.h>
+#include <learnopengl/texture_array.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/gpu_scene.h>
+#include <learnopengl/transparent_sorter.h>
+#include <learnopengl/weighted_oit.h>
 
 #include <iostream>
 using namespace std;
@@ -18,11 +25,13 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
-unsigned int loadTexture(const char *path);
+TextureLayer loadTexture(TextureArrays &arrays, AsyncTextureLoader &loader, const char *path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// bytes of decoded texture data uploaded per frame
+const size_t TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -30,10 +39,18 @@ float lastX = (float)SCR_WIDTH / 2.0;
 float lastY = (float)SCR_HEIGHT / 2.0;
 bool firstMouse = true;
 
+// transparency: sorted alpha blending, or weighted blended OIT (toggled with O)
+bool useWeightedOIT = false;
+bool oitKeyDown = false;
+
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// uniform handles, hashed at compile time
+constexpr UniformHandle MODEL_UNIFORM("model");
+constexpr UniformHandle COLOR_UNIFORM("color");
+
 int main()
 {
     // glfw: initialize and configure
@@ -71,16 +88,32 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // entry points beyond GL 3.3 used by optional features (program binaries, ...)
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
 
-     // build and compile shaders
+     // build and compile shaders; linked programs are cached on disk so warm starts skip compilation
     // -------------------------
+    ProgramCache::Enable("shader_cache");
     //Shader shader("shader/wall.vs", "shader/wall.fs", "shader/wall.gs");
-    Shader shader("shader/wall.vs", "shader/wall.fs");
+    // wall.fs can be specialized with ALPHA_TEST; permutations are compiled on first use, without
+    // blocking the render loop. Until the real program is ready the room is drawn with a flat colour.
+    ShaderVariants wallShader("shader/wall.vs", "shader/wall.fs", { "ALPHA_TEST" }, nullptr, true);
+    Shader &shader = wallShader.Get(0);
+    Shader fallbackShader("shader/wall.vs", "shader/2.stencil_single_color.fs");
+    // tinted glass panes, placed per instance; WEIGHTED_OIT writes them to the OIT targets instead
+    ShaderVariants transparentShaders("shader/model_instanced.vs", "shader/transparent.fs", { "WEIGHTED_OIT" });
+    const unsigned int WEIGHTED_OIT_KEY = transparentShaders.Keyword("WEIGHTED_OIT");
+    const glm::vec4 glassColor(0.55f, 0.75f, 0.85f, 0.35f);
+    // crates of the GPU driven scene; on GL 3.3 GpuScene draws them one by one with a model uniform
+    Shader crateShader(GpuScene::Supported() ? "shader/model_indirect.vs" : "shader/model.vs", "shader/model.fs");
+
+    // per-frame camera/time uniforms shared by every program through one uniform buffer
+    FrameUniforms frameUniforms;
     //Shader shaderSingleColor("shader/3.1.blending.vs", "shader/2.stencil_single_color.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
@@ -158,84 +191,37 @@ int main()
 
 
 
-    // plane VAO
-    unsigned int planeVAO, planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // wallFront VAO
-    unsigned int wallVAO, wallVBO;
-    glGenVertexArrays(1, &wallVAO);
-    glGenBuffers(1, &wallVBO);
-    glBindVertexArray(wallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, wallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallFrontVertices), wallFrontVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // Right wall VAO
-    unsigned int wallRightVAO, wallRightVBO;
-    glGenVertexArrays(1, &wallRightVAO);
-    glGenBuffers(1, &wallRightVBO);
-    glBindVertexArray(wallRightVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, wallRightVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallRightVertices), wallRightVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // Left wall VAO
-    unsigned int wallLeftVAO, wallLeftVBO;
-    glGenVertexArrays(1, &wallLeftVAO);
-    glGenBuffers(1, &wallLeftVBO);
-    glBindVertexArray(wallLeftVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, wallLeftVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallLeftVertices), wallLeftVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // Back wall VAO
-    unsigned int wallBackVAO, wallBackVBO;
-    glGenVertexArrays(1, &wallBackVAO);
-    glGenBuffers(1, &wallBackVBO);
-    glBindVertexArray(wallBackVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, wallBackVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallBackVertices), wallBackVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // Ceiling VAO
-    unsigned int ceilingVAO, ceilingVBO;
-    glGenVertexArrays(1, &ceilingVAO);
-    glGenBuffers(1, &ceilingVBO);
-    glBindVertexArray(ceilingVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, ceilingVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(ceilingVertices), ceilingVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    
     // load textures
     // -------------
-    unsigned int floorTexture = loadTexture("resources/textures/floor.png");
-    unsigned int wallTexture = loadTexture("resources/textures/wall.png");
-    unsigned int ceilingTexture = loadTexture("resources/textures/ceiling.png");
+    // files without a cooked .dds (see tools/texture_cooker.cpp) are decoded in parallel on the worker pool;
+    // textures loaded through textureLoader.Load later on are streamed in by textureLoader.Update without blocking a frame.
+    // idle workers also help with the IDCT and colour conversion of large JPEGs
+    ThreadPool threadPool;
+    ImageDecoder::SetThreadPool(&threadPool);
+    AsyncTextureLoader textureLoader(threadPool);
+    const char *roomTextures[] = { "resources/textures/floor.png", "resources/textures/wall.png", "resources/textures/ceiling.png" };
+    for (unsigned int i = 0; i < 3; i++)
+        if (!CompressedTexture::HasCooked(roomTextures[i]))
+            textureLoader.Decode(roomTextures[i]);
+
+    // all room textures are conformed to one layer size so they end up in a single texture array
+    TextureArrays textureArrays(512, 512);
+    TextureLayer floorTexture = loadTexture(textureArrays, textureLoader, roomTextures[0]);
+    TextureLayer wallTexture = loadTexture(textureArrays, textureLoader, roomTextures[1]);
+    TextureLayer ceilingTexture = loadTexture(textureArrays, textureLoader, roomTextures[2]);
+    textureArrays.Build(&threadPool);
+
+    // static room geometry: every surface is packed into one batch and drawn per texture array,
+    // the texture itself is selected per vertex by its layer
+    // --------------------------------------------------------------------------------------
+    StaticBatch roomBatch({ 3, 2 }, true);
+    roomBatch.AddSurface(planeVertices, 6, floorTexture.group, floorTexture.layer);
+    roomBatch.AddSurface(wallFrontVertices, 6, wallTexture.group, wallTexture.layer);
+    roomBatch.AddSurface(wallRightVertices, 6, wallTexture.group, wallTexture.layer);
+    roomBatch.AddSurface(wallLeftVertices, 6, wallTexture.group, wallTexture.layer);
+    roomBatch.AddSurface(wallBackVertices, 6, wallTexture.group, wallTexture.layer);
+    roomBatch.AddSurface(ceilingVertices, 6, ceilingTexture.group, ceilingTexture.layer);
+    roomBatch.Build();
 
     // transparent object locations
     // --------------------------------
@@ -248,10 +234,60 @@ int main()
         glm::vec3 (0.5f, 0.0f, -0.6f)
     };
 
-    // shader configuration
-    // --------------------
-    shader.use();
-    shader.setInt("texture1", 0);
+    // a unit pane that every transparent object is a copy of; all of them are drawn with one instanced draw
+    float paneVertices[] = {
+        // positions         // texture Coords
+        0.0f,  0.5f,  0.0f,  0.0f, 0.0f,
+        0.0f, -0.5f,  0.0f,  0.0f, 1.0f,
+        1.0f, -0.5f,  0.0f,  1.0f, 1.0f,
+        1.0f,  0.5f,  0.0f,  1.0f, 0.0f
+    };
+    vector<Vertex> paneMeshVertices;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        Vertex vertex = {};
+        vertex.Position = glm::vec3(paneVertices[i * 5], paneVertices[i * 5 + 1], paneVertices[i * 5 + 2]);
+        vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        vertex.TexCoords = glm::vec2(paneVertices[i * 5 + 3], paneVertices[i * 5 + 4]);
+        paneMeshVertices.push_back(vertex);
+    }
+    Mesh pane(std::move(paneMeshVertices), vector<unsigned int>{ 0, 1, 2, 0, 2, 3 }, vector<Texture>(), VERTEX_FORMAT_FULL, true);
+    vector<glm::mat4> paneTransforms;
+    TransparentSorter paneSorter;
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    WeightedBlendedOIT oit(framebufferWidth, framebufferHeight);
+
+    // a field of small crates on the floor, culled against the frustum and last frame's depth by the
+    // GPU driven scene path (GL 4.3); without it GpuScene culls them on the CPU instead
+    vector<Vertex> crateVertices;
+    vector<unsigned int> crateIndices;
+    for (int face = 0; face < 6; face++)
+    {
+        // the face's normal axis and the two axes spanning it, counter-clockwise seen from outside
+        int axis = face / 2;
+        glm::vec3 normal(0.0f), u(0.0f), v(0.0f);
+        normal[axis] = face % 2 ? -1.0f : 1.0f;
+        u[(axis + 1) % 3] = normal[axis];
+        v[(axis + 2) % 3] = 1.0f;
+        unsigned int first = (unsigned int)crateVertices.size();
+        for (unsigned int corner = 0; corner < 4; corner++)
+        {
+            Vertex vertex = {};
+            vertex.TexCoords = glm::vec2(corner == 1 || corner == 2 ? 1.0f : 0.0f, corner >= 2 ? 1.0f : 0.0f);
+            vertex.Position = 0.5f * normal + (vertex.TexCoords.x - 0.5f) * u + (vertex.TexCoords.y - 0.5f) * v;
+            vertex.Normal = normal;
+            crateVertices.push_back(vertex);
+        }
+        unsigned int quad[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+        crateIndices.insert(crateIndices.end(), quad, quad + 6);
+    }
+    unsigned int crateTexture = textureLoader.Load(roomTextures[1]);
+    Mesh crate(std::move(crateVertices), std::move(crateIndices), vector<Texture>{ { crateTexture, "texture_diffuse", roomTextures[1] } }, VERTEX_FORMAT_FULL, true);
+    GpuScene crates;
+    for (int x = -9; x <= 9; x++)
+        for (int z = -9; z <= 9; z++)
+            crates.Add(crate, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(x * 0.5f, -0.9f, z * 0.5f)), glm::vec3(0.2f)));
 
     // render loop
     // -----------
@@ -267,61 +303,73 @@ int main()
         // -----
         processInput(window);
 
+        // stream in finished texture decodes, at most TEXTURE_UPLOAD_BUDGET bytes per frame
+        textureLoader.Update(TEXTURE_UPLOAD_BUDGET);
+
         // render
         // ------
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // don't forget to clear the stencil buffer!
 
-        // set uniforms
+        // set uniforms: view/projection are uploaded once per frame for all programs
         glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-     
+        frameUniforms.Update(view, projection, camera.Position, currentFrame, deltaTime);
 
-        shader.use();
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
+        // skip to the fallback program while the real one is still compiling
+        Shader &roomShader = shader.isReady() ? shader : fallbackShader;
+        roomShader.use();
 
-        // draw floor as normal, but don't write the floor to the stencil buffer, we only care about the containers. We set its mask to 0x00 to not write to the stencil buffer.
+        // draw the room as normal, but don't write it to the stencil buffer. We set its mask to 0x00 to not write to the stencil buffer.
         glStencilMask(0x00);
-        // floor
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        shader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // the room geometry never moves, so model is set once and each texture array is a single multi-draw
+        roomShader.setMat4(MODEL_UNIFORM, model);
+        roomBatch.Bind();
+        for (unsigned int group = 0; group < roomBatch.MaterialCount(); group++)
+        {
+            textureArrays.Bind(group);
+            roomBatch.Draw(group);
+        }
         glBindVertexArray(0);
 
-        // wall
-        glBindVertexArray(wallVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        shader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-
-        glBindVertexArray(wallRightVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        shader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-
-        glBindVertexArray(wallLeftVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        shader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-
-        glBindVertexArray(wallBackVAO);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        shader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-
-        // ceiling
-        glBindVertexArray(ceilingVAO);
-        glBindTexture(GL_TEXTURE_2D, ceilingTexture);
-        shader.setMat4("model", glm::mat4(1.0f));
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
+        // the crates that survive culling, drawn with a few multi-draws; once all opaque geometry is
+        // in, its depth becomes the occlusion reference for next frame's culling
+        crates.Cull(projection * view);
+        crateShader.use();
+        crates.Draw(crateShader);
+        crates.UpdateDepthPyramid(0, framebufferWidth, framebufferHeight);
+
+        // transparent panes last, as a single instanced draw
+        Shader &transparentShader = transparentShaders.Get(useWeightedOIT ? WEIGHTED_OIT_KEY : 0);
+        transparentShader.use();
+        transparentShader.setVec4(COLOR_UNIFORM, glassColor);
+        paneTransforms.clear();
+        if (useWeightedOIT)
+        {
+            // order doesn't matter: the panes are accumulated and resolved over the room in one pass
+            for (unsigned int i = 0; i < trasparentObject.size(); i++)
+                paneTransforms.push_back(glm::translate(glm::mat4(1.0f), trasparentObject[i]));
+            oit.Resize(framebufferWidth, framebufferHeight);
+            oit.Begin();
+            pane.DrawInstanced(transparentShader, paneTransforms);
+            GeometryPool::Get().Unbind();
+            oit.End();
+        }
+        else
+        {
+            // farthest first so each one blends over what is behind it. The sorter repairs last
+            // frame's order; the sorted transforms go out as a single instanced draw, which keeps it.
+            const vector<unsigned int> &backToFront = paneSorter.Sort(trasparentObject.data(), (unsigned int)trasparentObject.size(), view);
+            for (unsigned int i = 0; i < backToFront.size(); i++)
+                paneTransforms.push_back(glm::translate(glm::mat4(1.0f), trasparentObject[backToFront[i]]));
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            pane.DrawInstanced(transparentShader, paneTransforms);
+            GeometryPool::Get().Unbind();
+            glDisable(GL_BLEND);
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -331,9 +379,22 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &planeVAO);
-    
-    glDeleteBuffers(1, &planeVBO);
+    roomBatch.Release();
+    textureArrays.Release();
+    pane.Release();
+    crates.Release();
+    crate.Release();
+    glDeleteTextures(1, &crateTexture);
+    oit.Release();
+    GeometryPool::Get().Release();
+    InstanceBuffer::Get().Release();
+    textureLoader.Release();
+    ImageDecoder::SetThreadPool(NULL);
+    frameUniforms.Release();
+    wallShader.Release();
+    glDeleteProgram(fallbackShader.ID);
+    transparentShaders.Release();
+    glDeleteProgram(crateShader.ID);
 
     glfwTerminate();
     return 0;
@@ -356,6 +417,12 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    // switch the transparency mode once per press
+    bool oitKey = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+    if (oitKey && !oitKeyDown)
+        useWeightedOIT = !useWeightedOIT;
+    oitKeyDown = oitKey;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -396,46 +463,40 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const * path)
+// utility function for loading a texture from file into a layer of a texture array
+// -----------------------------------------------------------------------------------
+TextureLayer loadTexture(TextureArrays &arrays, AsyncTextureLoader &loader, char const * path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    TextureLayer location = { 0, 0 };
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+    // a file that is already a layer of these arrays is shared instead of decoded again
+    TextureCacheKey key(TextureCache::Canonical(path), false, GL_TEXTURE_2D_ARRAY, &arrays);
+    const TextureCacheEntry *cached = TextureCache::Get().Acquire(key);
+    if (cached)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        /*
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        */
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-
-        stbi_image_free(data);
+        location.group = cached->id;
+        location.layer = cached->layer;
+        return location;
     }
-    else
+
+    // a cooked file of the right size is uploaded as is, without decoding the source
+    CompressedImage cooked;
+    if (CompressedTexture::Load(CompressedTexture::CookedPath(path), cooked) && arrays.AddCompressedLayer(cooked, location))
+    {
+        TextureCache::Get().Insert(key, location.group, location.layer);
+        return location;
+    }
+
+    // waits for the worker decode (usually started up front) and drops the pixels once they're copied;
+    // the loader already reported a failed decode
+    std::shared_ptr<DecodedImage> image = loader.Decode(path).get();
+    if (image->data)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        // the pixels are copied into the array's staging storage and uploaded by TextureArrays::Build
+        location = arrays.AddLayer(image->data, image->width, image->height, image->components);
+        TextureCache::Get().Insert(key, location.group, location.layer);
     }
+    loader.Discard(path);
 
-    return textureID;
+    return location;
 }
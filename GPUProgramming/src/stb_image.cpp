@@ -0,0 +1,10 @@
+// the stb_image implementation, compiled once. It allocates through the per thread arena and splits
+// large JPEGs over the decoder's thread pool (see image_decoder.h).
+#include <learnopengl/image_decoder.h>
+
+#define STBI_MALLOC(sz) ImageArena::Malloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) ImageArena::Realloc(p, oldsz, newsz)
+#define STBI_FREE(p) ImageArena::Free(p)
+#define STBI_PARALLEL_FOR(count, job, context) ImageDecoder::ParallelFor(count, job, context)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
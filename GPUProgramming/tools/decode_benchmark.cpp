@@ -0,0 +1,156 @@
+// Decode benchmark: decodes every image in a directory (resources/textures by default) a number of
+// times with the same stb_image configuration main.cpp uses and prints the best time per image,
+// once on the calling thread only and once with the worker pool helping (see ImageDecoder).
+//
+// build (from GPUProgramming/):
+//   cl /EHsc /O2 /Iinclude tools\decode_benchmark.cpp
+//   g++ -O2 -Iinclude tools/decode_benchmark.cpp -o decode_benchmark -lpthread
+//
+// usage:
+//   decode_benchmark [--runs <count>] [<directory>]
+//
+// the SIMD kernels are picked at runtime; build again with -DSTBI_NO_AVX2 (SSE2 only) or
+// -DSTBI_NO_SIMD (scalar) to compare against them.
+#include <learnopengl/image_decoder.h>
+#define STBI_MALLOC(sz) ImageArena::Malloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) ImageArena::Realloc(p, oldsz, newsz)
+#define STBI_FREE(p) ImageArena::Free(p)
+#define STBI_PARALLEL_FOR(count, job, context) ImageDecoder::ParallelFor(count, job, context)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+std::vector<std::string> listImages(const std::string &directory);
+double decodeMilliseconds(const MappedFile &file, int runs);
+void printUsage();
+
+int main(int argc, char **argv)
+{
+    int runs = 10;
+    std::string directory = "resources/textures";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg[0] != '-')
+            directory = arg;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::vector<std::string> paths = listImages(directory);
+    if (paths.empty())
+    {
+        std::cout << "no images in " << directory << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool;
+    std::cout << "best of " << runs << " runs, " << pool.Size() << " pool threads" << std::endl;
+    std::cout << std::left << std::setw(40) << "image" << std::right << std::setw(12) << "size" << std::setw(12) << "1 thread"
+              << std::setw(12) << "pool" << std::setw(12) << "MP/s" << std::endl;
+    double serialTotal = 0.0, parallelTotal = 0.0, megapixels = 0.0;
+    for (unsigned int i = 0; i < paths.size(); i++)
+    {
+        MappedFile file(paths[i]);
+        int width, height, components;
+        if (!ImageDecoder::Info(file, width, height, components))
+            continue;
+
+        ImageDecoder::SetThreadPool(NULL);
+        double serial = decodeMilliseconds(file, runs);
+        ImageDecoder::SetThreadPool(&pool);
+        double parallel = decodeMilliseconds(file, runs);
+        if (serial < 0.0 || parallel < 0.0)
+        {
+            std::cout << "Texture failed to load at path: " << paths[i] << std::endl;
+            continue;
+        }
+
+        double pixels = (double)width * height / 1e6;
+        serialTotal += serial;
+        parallelTotal += parallel;
+        megapixels += pixels;
+        std::string size = std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(components);
+        std::cout << std::left << std::setw(40) << paths[i].substr(paths[i].find_last_of("/\\") + 1) << std::right << std::setw(12) << size
+                  << std::fixed << std::setprecision(2) << std::setw(10) << serial << "ms" << std::setw(10) << parallel << "ms"
+                  << std::setw(12) << pixels / (std::min(serial, parallel) / 1000.0) << std::endl;
+    }
+    ImageDecoder::SetThreadPool(NULL);
+    std::cout << std::left << std::setw(52) << "total" << std::right << std::fixed << std::setprecision(2) << std::setw(10) << serialTotal << "ms"
+              << std::setw(10) << parallelTotal << "ms" << std::setw(12) << megapixels / (std::min(serialTotal, parallelTotal) / 1000.0) << std::endl;
+    return 0;
+}
+
+// png and jpg files of a directory, sorted by name
+std::vector<std::string> listImages(const std::string &directory)
+{
+    std::vector<std::string> names;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &entry);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+            names.push_back(entry.cFileName);
+        while (FindNextFileA(find, &entry));
+        FindClose(find);
+    }
+#else
+    if (DIR *dir = opendir(directory.c_str()))
+    {
+        while (dirent *entry = readdir(dir))
+            names.push_back(entry->d_name);
+        closedir(dir);
+    }
+#endif
+    std::vector<std::string> paths;
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        std::string extension = names[i].substr(names[i].find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == "png" || extension == "jpg" || extension == "jpeg")
+            paths.push_back(directory + "/" + names[i]);
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// best time of 'runs' decodes in an arena scope, like the texture loader's workers; -1 if it fails
+double decodeMilliseconds(const MappedFile &file, int runs)
+{
+    double best = -1.0;
+    for (int run = 0; run < runs; run++)
+    {
+        ImageArena::Scope scope;
+        int width, height, components;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned char *pixels = ImageDecoder::Decode(file, width, height, components);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!pixels)
+            return -1.0;
+        stbi_image_free(pixels);
+        if (best < 0.0 || milliseconds < best)
+            best = milliseconds;
+    }
+    return best;
+}
+
+void printUsage()
+{
+    std::cout << "usage: decode_benchmark [--runs <count>] [<directory>]" << std::endl;
+}
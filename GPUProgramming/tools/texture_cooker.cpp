@@ -0,0 +1,178 @@
+// Offline texture cooker: converts a source image into a block compressed DDS with a full mip chain,
+// which the runtime uploads with glCompressedTexImage2D (see include/learnopengl/compressed_texture.h).
+// Cooked files sit next to their source with a .dds extension and are picked up automatically.
+//
+// build (from GPUProgramming/):
+//   cl /EHsc /O2 /Iinclude tools\texture_cooker.cpp
+//   g++ -O2 -Iinclude tools/texture_cooker.cpp -o texture_cooker -lpthread
+//
+// usage:
+//   texture_cooker [--format bc1|bc3|bc5|bc7] [--srgb] [--box] [--size <width> <height>] <source> [<output.dds>]
+//
+// without --format, opaque images become BC1 and images with alpha BC3. --size resamples the image
+// first, e.g. --size 512 512 for the room textures, which main.cpp keeps in a 512x512 texture array.
+// mips are Kaiser filtered by MipGenerator (gamma correct with --srgb), --box picks the 2x2 average.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <learnopengl/bc_encoder.h>
+#include <learnopengl/compressed_texture.h>
+#include <learnopengl/mip_generator.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+std::vector<unsigned char> resample(const std::vector<unsigned char> &rgba, int width, int height, int newWidth, int newHeight);
+void printUsage();
+
+int main(int argc, char **argv)
+{
+    BlockFormat format = BLOCK_FORMAT_BC1;
+    bool formatGiven = false;
+    bool srgb = false;
+    MipFilter filter = MIP_FILTER_KAISER;
+    int targetWidth = 0, targetHeight = 0;
+    std::string source, output;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            formatGiven = true;
+            if (name == "bc1")
+                format = BLOCK_FORMAT_BC1;
+            else if (name == "bc3")
+                format = BLOCK_FORMAT_BC3;
+            else if (name == "bc5")
+                format = BLOCK_FORMAT_BC5;
+            else if (name == "bc7")
+                format = BLOCK_FORMAT_BC7;
+            else
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (arg == "--srgb")
+            srgb = true;
+        else if (arg == "--box")
+            filter = MIP_FILTER_BOX;
+        else if (arg == "--size" && i + 2 < argc)
+        {
+            targetWidth = std::atoi(argv[++i]);
+            targetHeight = std::atoi(argv[++i]);
+        }
+        else if (source.empty())
+            source = arg;
+        else if (output.empty())
+            output = arg;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    if (source.empty())
+    {
+        printUsage();
+        return 1;
+    }
+    if (output.empty())
+        output = CompressedTexture::CookedPath(source);
+
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(source.c_str(), &width, &height, &nrComponents, 4);
+    if (!data)
+    {
+        std::cout << "Texture failed to load at path: " << source << std::endl;
+        return 1;
+    }
+    std::vector<unsigned char> pixels(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    if (!formatGiven && (nrComponents == 2 || nrComponents == 4))
+        format = BLOCK_FORMAT_BC3;
+    if (targetWidth > 0 && targetHeight > 0 && (targetWidth != width || targetHeight != height))
+    {
+        pixels = resample(pixels, width, height, targetWidth, targetHeight);
+        width = targetWidth;
+        height = targetHeight;
+    }
+
+    // build the mip chain down to 1x1 first, then compress the levels in parallel
+    std::vector<MipLevel> mips(1);
+    mips[0].width = width;
+    mips[0].height = height;
+    mips[0].pixels = pixels;
+    std::vector<MipLevel> chain = MipGenerator::Generate(pixels.data(), width, height, 4, filter, srgb && format != BLOCK_FORMAT_BC5);
+    for (unsigned int level = 0; level < chain.size(); level++)
+        mips.push_back(std::move(chain[level]));
+
+    CompressedImage image;
+    image.format = format;
+    image.srgb = srgb && format != BLOCK_FORMAT_BC5;
+    image.width = width;
+    image.height = height;
+    image.levels.resize(mips.size());
+    ThreadPool pool;
+    std::vector<std::future<std::vector<unsigned char>>> levels;
+    for (unsigned int level = 0; level < mips.size(); level++)
+    {
+        const MipLevel *mip = &mips[level];
+        levels.push_back(pool.Async([mip, format]() {
+            return BlockEncoder::Encode(mip->pixels.data(), mip->width, mip->height, format);
+        }));
+    }
+    for (unsigned int level = 0; level < levels.size(); level++)
+        image.levels[level] = levels[level].get();
+
+    if (!CompressedTexture::Save(output, image))
+        return 1;
+    size_t compressedSize = 0, sourceSize = 0;
+    for (unsigned int level = 0; level < image.levels.size(); level++)
+    {
+        compressedSize += image.levels[level].size();
+        sourceSize += mips[level].pixels.size();
+    }
+    std::cout << output << ": " << width << "x" << height << ", " << image.levels.size() << " levels, "
+              << compressedSize << " bytes (RGBA8: " << sourceSize << ")" << std::endl;
+    return 0;
+}
+
+// bilinear resampling to an arbitrary size
+std::vector<unsigned char> resample(const std::vector<unsigned char> &rgba, int width, int height, int newWidth, int newHeight)
+{
+    std::vector<unsigned char> pixels((size_t)newWidth * newHeight * 4);
+    for (int y = 0; y < newHeight; y++)
+    {
+        float sy = std::max(0.0f, (y + 0.5f) * height / newHeight - 0.5f);
+        int y0 = std::min(static_cast<int>(sy), height - 1);
+        int y1 = std::min(y0 + 1, height - 1);
+        float fy = sy - y0;
+        for (int x = 0; x < newWidth; x++)
+        {
+            float sx = std::max(0.0f, (x + 0.5f) * width / newWidth - 0.5f);
+            int x0 = std::min(static_cast<int>(sx), width - 1);
+            int x1 = std::min(x0 + 1, width - 1);
+            float fx = sx - x0;
+            for (int c = 0; c < 4; c++)
+            {
+                float top    = rgba[((size_t)y0 * width + x0) * 4 + c] * (1.0f - fx) + rgba[((size_t)y0 * width + x1) * 4 + c] * fx;
+                float bottom = rgba[((size_t)y1 * width + x0) * 4 + c] * (1.0f - fx) + rgba[((size_t)y1 * width + x1) * 4 + c] * fx;
+                pixels[((size_t)y * newWidth + x) * 4 + c] = static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+    return pixels;
+}
+
+void printUsage()
+{
+    std::cout << "usage: texture_cooker [--format bc1|bc3|bc5|bc7] [--srgb] [--box] [--size <width> <height>] <source> [<output.dds>]" << std::endl;
+}